@@ -1,8 +1,11 @@
 #ifndef OSCILLATORD_GNSS_F9_DEFVALSETS2
 #define OSCILLATORD_GNSS_F9_DEFVALSETS2
 
-extern const char default_configuration[284][128];
+#include <ubloxcfg/ubloxcfg.h>
+
+/* Generated at build time from gnss_config text files, sorted by key ID */
+extern const UBLOXCFG_KEYVAL_t default_configuration[];
 extern const int default_configuration_size;
-extern const char default_configuration_v220[297][128];
+extern const UBLOXCFG_KEYVAL_t default_configuration_v220[];
 extern const int default_configuration_v220_size;
 #endif
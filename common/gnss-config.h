@@ -5,6 +5,22 @@
 #include <ubloxcfg/ubloxcfg.h>
 
 bool check_gnss_config_in_ram(RX_t *rx, UBLOXCFG_KEYVAL_t *allKvCfg, int nAllKvCfg);
+/* Get keys of allKvCfg whose value differs in receiver's RAM layer.
+ * Returns number of keys in diffKv, to be freed by caller, or a negative
+ * error code. needsReset tells if a differing key is only applied after a
+ * reset. */
+int gnss_config_diff(RX_t *rx, const UBLOXCFG_KEYVAL_t *allKvCfg, int nAllKvCfg,
+    UBLOXCFG_KEYVAL_t **diffKv, bool *needsReset);
 UBLOXCFG_KEYVAL_t *get_default_value_from_config(int *nKv, int major, int minor);
 
+/* Key holding the fingerprint of the configuration applied by oscillatord.
+ * USB serial number string is not used on the ART card. */
+#define GNSS_CONFIG_FINGERPRINT_ID UBLOXCFG_CFG_USB_SERIAL_NO_STR3_ID
+/* Hash of a configuration sorted by key ID and of receiver version string */
+uint64_t gnss_config_fingerprint(const UBLOXCFG_KEYVAL_t *allKvCfg, int nAllKvCfg, const char *version);
+/* Check receiver's fingerprint key and a few critical keys of allKvCfg,
+ * which must be sorted by key ID */
+bool gnss_config_check_fingerprint(RX_t *rx, const UBLOXCFG_KEYVAL_t *allKvCfg, int nAllKvCfg, uint64_t fingerprint);
+bool gnss_config_store_fingerprint(RX_t *rx, uint64_t fingerprint);
+
 #endif /* OSCILLATORD_GNSS_CONFIG_H */
@@ -0,0 +1,196 @@
+/**
+ * @file boot_timeline.c
+ * @brief Timeline of oscillatord start up, until the clock is locked
+ * @date 2023-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <pthread.h>
+
+#include "boot_timeline.h"
+#include "log.h"
+
+static const char *boot_milestone_names[BOOT_MILESTONE_NUM] = {
+	[BOOT_CONFIG_PARSED] = "config_parsed",
+	[BOOT_OSCILLATOR_READY] = "oscillator_ready",
+	[BOOT_EEPROM_READ] = "eeprom_read",
+	[BOOT_GNSS_CONFIGURED] = "gnss_configured",
+	[BOOT_TAI_TIME] = "tai_time",
+	[BOOT_PHC_SET] = "phc_set",
+	[BOOT_INITIAL_PHASE_JUMP] = "initial_phase_jump",
+	[BOOT_SURVEY_DONE] = "survey_done",
+	[BOOT_FIRST_OD_PROCESS] = "first_od_process",
+	[BOOT_READY_FOR_HOLDOVER] = "ready_for_holdover",
+	[BOOT_CLOCK_CLASS_LOCK] = "clock_class_lock",
+};
+
+static pthread_mutex_t boot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec boot_start;
+static struct boot_timeline boot_timeline;
+/** Read without lock so that marking a reached milestone is cheap */
+static bool boot_reached[BOOT_MILESTONE_NUM];
+static bool boot_state_known;
+static enum Disciplining_State boot_state;
+static bool boot_logged;
+/** Tools sharing the GNSS code do not record a timeline */
+static bool boot_started;
+
+static double boot_elapsed(const struct timespec *monotonic)
+{
+	return (monotonic->tv_sec - boot_start.tv_sec) +
+		(monotonic->tv_nsec - boot_start.tv_nsec) / 1e9;
+}
+
+const char *cstring_from_boot_milestone(enum boot_milestone milestone)
+{
+	if (milestone < 0 || milestone >= BOOT_MILESTONE_NUM)
+		return "unknown";
+	return boot_milestone_names[milestone];
+}
+
+/**
+ * @brief Start timeline, to be called first thing in main
+ */
+void boot_timeline_start(void)
+{
+	pthread_mutex_lock(&boot_mutex);
+	clock_gettime(CLOCK_MONOTONIC, &boot_start);
+	clock_gettime(CLOCK_REALTIME, &boot_timeline.start_realtime);
+	for (int i = 0; i < BOOT_MILESTONE_NUM; i++) {
+		boot_timeline.milestones[i] = -1.0;
+		__atomic_store_n(&boot_reached[i], false, __ATOMIC_RELAXED);
+	}
+	boot_timeline.transitions_count = 0;
+	boot_timeline.transitions_dropped = 0;
+	boot_state_known = false;
+	boot_logged = false;
+	boot_started = true;
+	pthread_mutex_unlock(&boot_mutex);
+}
+
+/**
+ * @brief Record milestone at a given time, only the first time it is reached
+ *
+ * @param milestone
+ * @param monotonic CLOCK_MONOTONIC time milestone was reached at
+ */
+void boot_timeline_mark_at(enum boot_milestone milestone, const struct timespec *monotonic)
+{
+	double elapsed;
+
+	if (milestone < 0 || milestone >= BOOT_MILESTONE_NUM ||
+		__atomic_load_n(&boot_reached[milestone], __ATOMIC_ACQUIRE))
+		return;
+
+	pthread_mutex_lock(&boot_mutex);
+	if (!boot_started || boot_reached[milestone]) {
+		pthread_mutex_unlock(&boot_mutex);
+		return;
+	}
+	elapsed = boot_elapsed(monotonic);
+	boot_timeline.milestones[milestone] = elapsed;
+	__atomic_store_n(&boot_reached[milestone], true, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&boot_mutex);
+
+	log_info("Boot timeline: %s after %.3fs", boot_milestone_names[milestone], elapsed);
+}
+
+/**
+ * @brief Record milestone now, only the first time it is reached
+ *
+ * @param milestone
+ */
+void boot_timeline_mark(enum boot_milestone milestone)
+{
+	struct timespec now;
+
+	if (milestone < 0 || milestone >= BOOT_MILESTONE_NUM ||
+		__atomic_load_n(&boot_reached[milestone], __ATOMIC_ACQUIRE))
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	boot_timeline_mark_at(milestone, &now);
+}
+
+/**
+ * @brief Record convergence milestones from disciplining algorithm status
+ *
+ * Timeline is logged when clock class first reaches lock.
+ *
+ * @param disciplining monitoring data of the algorithm
+ */
+void boot_timeline_update(const struct od_monitoring *disciplining)
+{
+	struct timespec now;
+	bool changed;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	pthread_mutex_lock(&boot_mutex);
+	changed = !boot_state_known || disciplining->status != boot_state;
+	if (changed) {
+		if (boot_timeline.transitions_count < BOOT_TIMELINE_TRANSITIONS_MAX) {
+			boot_timeline.transitions[boot_timeline.transitions_count++] = (struct boot_transition) {
+				.state = disciplining->status,
+				.elapsed = boot_elapsed(&now),
+			};
+		} else {
+			boot_timeline.transitions_dropped++;
+		}
+		boot_state = disciplining->status;
+		boot_state_known = true;
+	}
+	pthread_mutex_unlock(&boot_mutex);
+	if (changed)
+		log_info("Boot timeline: disciplining state %s after %.3fs",
+			cstring_from_disciplining_state(disciplining->status), boot_elapsed(&now));
+
+	if (disciplining->ready_for_holdover)
+		boot_timeline_mark_at(BOOT_READY_FOR_HOLDOVER, &now);
+	if (disciplining->clock_class == CLOCK_CLASS_LOCK) {
+		boot_timeline_mark_at(BOOT_CLOCK_CLASS_LOCK, &now);
+		boot_timeline_log();
+	}
+}
+
+/**
+ * @brief Copy timeline
+ *
+ * @param timeline
+ */
+void boot_timeline_get(struct boot_timeline *timeline)
+{
+	pthread_mutex_lock(&boot_mutex);
+	*timeline = boot_timeline;
+	pthread_mutex_unlock(&boot_mutex);
+}
+
+/**
+ * @brief Log timeline, only once per run
+ */
+void boot_timeline_log(void)
+{
+	struct boot_timeline timeline;
+
+	pthread_mutex_lock(&boot_mutex);
+	if (boot_logged) {
+		pthread_mutex_unlock(&boot_mutex);
+		return;
+	}
+	boot_logged = true;
+	timeline = boot_timeline;
+	pthread_mutex_unlock(&boot_mutex);
+
+	log_info("Boot timeline:");
+	for (int i = 0; i < BOOT_MILESTONE_NUM; i++) {
+		if (timeline.milestones[i] >= 0.0)
+			log_info("\t%-20s %10.3fs", boot_milestone_names[i], timeline.milestones[i]);
+		else
+			log_info("\t%-20s not reached", boot_milestone_names[i]);
+	}
+	for (int i = 0; i < timeline.transitions_count; i++)
+		log_info("\tstate %-14s %10.3fs",
+			cstring_from_disciplining_state(timeline.transitions[i].state),
+			timeline.transitions[i].elapsed);
+	if (timeline.transitions_dropped > 0)
+		log_info("\t%d more state transitions", timeline.transitions_dropped);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file boot_timeline.h
+ * @brief Timeline of oscillatord start up, until the clock is locked
+ * @date 2023-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Milestones of start up and convergence are recorded once, in seconds of
+ * CLOCK_MONOTONIC since oscillatord started, from main loop or GNSS thread.
+ * Disciplining state transitions are recorded as well. Timeline is logged
+ * once, when clock class first reaches lock or when oscillatord stops, and
+ * is served to monitoring clients.
+ */
+#ifndef OSCILLATORD_BOOT_TIMELINE_H
+#define OSCILLATORD_BOOT_TIMELINE_H
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <oscillator-disciplining/oscillator-disciplining.h>
+
+/** Maximum number of disciplining state transitions recorded */
+#define BOOT_TIMELINE_TRANSITIONS_MAX 32
+
+enum boot_milestone {
+	BOOT_CONFIG_PARSED,
+	BOOT_OSCILLATOR_READY,
+	BOOT_EEPROM_READ,
+	BOOT_GNSS_CONFIGURED,
+	BOOT_TAI_TIME,
+	BOOT_PHC_SET,
+	BOOT_INITIAL_PHASE_JUMP,
+	BOOT_SURVEY_DONE,
+	BOOT_FIRST_OD_PROCESS,
+	BOOT_READY_FOR_HOLDOVER,
+	BOOT_CLOCK_CLASS_LOCK,
+	BOOT_MILESTONE_NUM
+};
+
+/**
+ * @struct boot_transition
+ * @brief Disciplining state entered and when
+ */
+struct boot_transition {
+	enum Disciplining_State state;
+	double elapsed;
+};
+
+/**
+ * @struct boot_timeline
+ * @brief Copy of the timeline, times in seconds since start
+ */
+struct boot_timeline {
+	/** Realtime oscillatord started at */
+	struct timespec start_realtime;
+	/** Negative if milestone has not been reached */
+	double milestones[BOOT_MILESTONE_NUM];
+	struct boot_transition transitions[BOOT_TIMELINE_TRANSITIONS_MAX];
+	/** Transitions recorded, further ones are only counted */
+	int transitions_count;
+	int transitions_dropped;
+};
+
+void boot_timeline_start(void);
+void boot_timeline_mark(enum boot_milestone milestone);
+void boot_timeline_mark_at(enum boot_milestone milestone, const struct timespec *monotonic);
+void boot_timeline_update(const struct od_monitoring *disciplining);
+void boot_timeline_get(struct boot_timeline *timeline);
+void boot_timeline_log(void);
+const char *cstring_from_boot_milestone(enum boot_milestone milestone);
+
+#endif /* OSCILLATORD_BOOT_TIMELINE_H */
@@ -119,7 +119,8 @@ static inline void memory_barrier(void)
     /* do it the OS X way */
     OSMemoryBarrier();
 #elif defined(__GNUC__)
-    __asm__ __volatile__ ("" : : : "memory");
+    /* a compiler barrier alone does not order stores on weakly ordered CPUs */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
 #endif
 }
 
@@ -0,0 +1,353 @@
+/**
+ * @file control_loop.c
+ * @brief Disciplining control loop, independent of the devices it runs on
+ * @date 2023-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <errno.h>
+#include <string.h>
+
+#include "control_loop.h"
+#include "log.h"
+#include "utils.h"
+
+/**
+ * @brief Read disciplining algorithm configuration
+ *
+ * @param config configuration
+ * @param minipod_config configuration of the disciplining algorithm
+ */
+void control_loop_read_minipod_config(const struct config *config,
+	struct minipod_config *minipod_config)
+{
+	minipod_config->calibrate_first = config_get_bool_default(config, "calibrate_first", false);
+	minipod_config->debug = config_get_unsigned_number(config, "debug");
+	minipod_config->fine_stop_tolerance = config_get_unsigned_number(config, "fine_stop_tolerance");
+	minipod_config->max_allowed_coarse = config_get_unsigned_number(config, "max_allowed_coarse");
+	minipod_config->nb_calibration = config_get_unsigned_number(config, "nb_calibration");
+	minipod_config->phase_jump_threshold_ns = config_get_unsigned_number(config, "phase_jump_threshold_ns");
+	minipod_config->phase_resolution_ns = config_get_unsigned_number(config, "phase_resolution_ns");
+	minipod_config->reactivity_max = config_get_unsigned_number(config, "reactivity_max");
+	minipod_config->reactivity_min = config_get_unsigned_number(config, "reactivity_min");
+	minipod_config->reactivity_power = config_get_unsigned_number(config, "reactivity_power");
+	minipod_config->ref_fluctuations_ns = config_get_unsigned_number(config, "ref_fluctuations_ns");
+	minipod_config->oscillator_factory_settings = config_get_bool_default(config, "oscillator_factory_settings", true);
+	minipod_config->learn_temperature_table = config_get_bool_default(config, "learn_temperature_table", false);
+	minipod_config->use_temperature_table = config_get_bool_default(config, "use_temperature_table", false);
+	minipod_config->fine_table_output_path = config_get_default(config, "fine_table_output_path", "/tmp/");
+}
+
+/**
+ * @brief Create disciplining algorithm and prepare control loop
+ *
+ * @param control_loop control loop to initialize
+ * @param config configuration
+ * @param dsc_params disciplining parameters read from EEPROM
+ * @param oscillator oscillator to discipline
+ * @param ops devices giving inputs of the loop
+ * @param data passed to ops
+ * @return 0 on success, negative error code otherwise
+ */
+int control_loop_init(struct control_loop *control_loop, const struct config *config,
+	struct disciplining_parameters *dsc_params, struct oscillator *oscillator,
+	const struct control_loop_ops *ops, void *data)
+{
+	struct minipod_config minipod_config = {0};
+	char err_msg[OD_ERR_MSG_LEN];
+	long value;
+
+	if (control_loop == NULL || config == NULL || dsc_params == NULL || oscillator == NULL ||
+		ops == NULL || ops->get_phase_error == NULL || ops->get_gnss_epoch == NULL ||
+		ops->get_gnss_qerr == NULL || ops->apply_phase_offset == NULL) {
+		log_error("control_loop_init: one input is NULL");
+		return -EINVAL;
+	}
+
+	*control_loop = (struct control_loop) {
+		.ops = ops,
+		.data = data,
+		.oscillator = oscillator,
+		.calibration = { .state = CALIBRATION_IDLE },
+	};
+	control_loop->sign = config_get_bool_default(config, "opposite-phase-error", false) ? -1 : 1;
+
+	control_loop->calibration_settings.adaptive = config_get_bool_default(config,
+			"calibration_adaptive", false);
+	value = config_get_unsigned_number(config, "calibration_drift_tolerance_ps");
+	control_loop->calibration_settings.drift_tolerance_ps = value > 0 ? value : CALIBRATION_DRIFT_TOLERANCE_PS;
+	value = config_get_unsigned_number(config, "calibration_max_measures");
+	control_loop->calibration_settings.max_measures = value > 0 ? value : 0;
+
+	control_loop_read_minipod_config(config, &minipod_config);
+
+	/* Create shared library oscillator object */
+	control_loop->od = od_new_from_config(&minipod_config, dsc_params, err_msg);
+	if (control_loop->od == NULL) {
+		log_error("od_new %s", err_msg);
+		return errno != 0 ? -errno : -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Start calibration requested by the algorithm
+ */
+static int control_loop_start_calibration(struct control_loop *control_loop)
+{
+	struct calibration_parameters *calib_params;
+	int ret;
+
+	log_info("Calibration requested");
+	if (control_loop->ops->calibration_requested != NULL) {
+		struct od_monitoring disciplining;
+
+		if (od_get_monitoring_data(control_loop->od, &disciplining) == 0)
+			control_loop->ops->calibration_requested(control_loop->data, &disciplining);
+	}
+	calib_params = od_get_calibration_parameters(control_loop->od);
+	if (calib_params == NULL) {
+		log_error("od_get_calibration_parameters");
+		return -ENOMEM;
+	}
+
+	/* Calibration progresses at each step of the loop */
+	ret = oscillator_calibration_start(control_loop->oscillator, &control_loop->calibration,
+		calib_params, &control_loop->calibration_settings);
+	if (ret < 0)
+		log_error("oscillator_calibration_start");
+	return ret;
+}
+
+/**
+ * @brief Feed calibration with phase error of the pulse
+ */
+static int control_loop_calibrate(struct control_loop *control_loop, int phasemeter_status)
+{
+	struct calibration_sample calibration_sample = {
+		.phasemeter_status = phasemeter_status,
+		.phase_error = control_loop->osc_attr.phase_error,
+		.qErr = control_loop->input.qErr,
+		.qerr_matched = control_loop->qerr_matched,
+	};
+	int ret;
+
+	ret = oscillator_calibrate(control_loop->oscillator, &control_loop->calibration,
+		&calibration_sample);
+	if (ret == CALIBRATION_DONE) {
+		log_info("Calibration measures done");
+		od_calibrate(control_loop->od, control_loop->calibration.params,
+			control_loop->calibration.results);
+		/* Results now belong to disciplining algorithm */
+		control_loop->calibration.params = NULL;
+		control_loop->calibration.results = NULL;
+	} else if (ret == CALIBRATION_FAILED || ret < 0) {
+		oscillator_calibration_release(&control_loop->calibration);
+		log_error("oscillator_calibrate");
+		return -EIO;
+	}
+	control_loop->output.action = NO_OP;
+	return 0;
+}
+
+/**
+ * @brief Apply output of the algorithm
+ */
+static int control_loop_apply_output(struct control_loop *control_loop)
+{
+	struct od_output *output = &control_loop->output;
+	int ret;
+
+	if (output->action == PHASE_JUMP) {
+		log_info("Phase jump requested");
+		ret = control_loop->ops->apply_phase_offset(control_loop->data, -output->value_phase_ctrl);
+		if (ret < 0) {
+			log_error("apply_phase_offset");
+			return ret;
+		}
+		control_loop->ignore_next_irq = true;
+
+	} else if (output->action == CALIBRATE && control_loop->calibration.state == CALIBRATION_ABORTED) {
+		/* Disciplining is suspended until a new calibration is requested */
+		log_debug("Calibration was aborted, waiting for a calibration request");
+	} else if (output->action == CALIBRATE) {
+		return control_loop_start_calibration(control_loop);
+
+	} else if (output->action == SAVE_DISCIPLINING_PARAMETERS) {
+		struct disciplining_parameters dsc_params;
+
+		if (control_loop->ops->save_disciplining_parameters == NULL)
+			return 0;
+		ret = od_get_disciplining_parameters(control_loop->od, &dsc_params);
+		if (ret != 0) {
+			log_error("Could not get discipling parameters from disciplining algorithm");
+			return 0;
+		}
+		control_loop->ops->save_disciplining_parameters(control_loop->data, &dsc_params);
+	} else if (output->action != NO_OP) {
+		ret = oscillator_apply_output(control_loop->oscillator, output);
+		if (ret < 0) {
+			log_error("Could not apply output on oscillator !");
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Run one iteration of the control loop, on the next pulse
+ *
+ * @param control_loop
+ * @return 0 when the pulse was processed, -EAGAIN when it was skipped,
+ * -ENODATA if GNSS data could not be read, other negative error code if
+ * disciplining cannot go on
+ */
+int control_loop_step(struct control_loop *control_loop)
+{
+	struct od_input *input = &control_loop->input;
+	int64_t pps_second = 0;
+	int phasemeter_status;
+	int ret;
+
+	/* Get Phase error and status*/
+	phasemeter_status = control_loop->ops->get_phase_error(control_loop->data,
+		&control_loop->osc_attr.phase_error, &pps_second);
+
+	if (control_loop->ops->get_gnss_epoch(control_loop->data, &input->valid, &input->survey_completed) != 0) {
+		log_error("Error getting GNSS data");
+		return -ENODATA;
+	}
+	/* Only apply quantization error of the pulse phase error was measured on */
+	control_loop->qerr_matched = phasemeter_status == PHASEMETER_BOTH_TIMESTAMPS &&
+		control_loop->ops->get_gnss_qerr(control_loop->data, pps_second, &input->qErr) == 0;
+	if (!control_loop->qerr_matched) {
+		log_debug("No quantization error for pulse %" PRIi64, pps_second);
+		input->qErr = 0;
+	}
+	/* Wait for phase error before getting oscillator control values */
+	/* This prevents control values to be read right after writing them */
+
+	/* Oscillator control values and temperature are needed for
+	* the disciplining algorithm and monitoring, get both of them
+	*/
+	ret = oscillator_parse_attributes(control_loop->oscillator, &control_loop->osc_attr);
+	if (ret == -ENOSYS) {
+		control_loop->osc_attr.temperature = 0.0;
+		control_loop->osc_attr.locked = false;
+	} else if (ret < 0) {
+		log_warn("Coud not get temperature of oscillator");
+		return -EAGAIN;
+	}
+
+	ret = oscillator_get_ctrl(control_loop->oscillator, &control_loop->ctrl_values);
+	if (ret != 0) {
+		log_warn("Could not get control values of oscillator");
+		return -EAGAIN;
+	}
+
+	if (control_loop->ignore_next_irq) {
+		log_debug("ignoring 1 input due to phase jump");
+		control_loop->ignore_next_irq = false;
+		return -EAGAIN;
+	}
+
+	/* Fills in input structure with current phasemeter status */
+	input->phasemeter_status = phasemeter_status;
+
+	if (control_loop->output.action == ADJUST_FINE &&
+		control_loop->output.setpoint != control_loop->ctrl_values.fine_ctrl) {
+		log_error("Could not apply output to mro50");
+		log_error("Requested value was %u, control value read is %u",
+			control_loop->output.setpoint, control_loop->ctrl_values.fine_ctrl);
+	}
+
+	/* Fills in input structure for disciplining algorithm */
+	input->coarse_setpoint = control_loop->ctrl_values.coarse_ctrl;
+	input->fine_setpoint = control_loop->ctrl_values.fine_ctrl;
+	input->temperature = control_loop->osc_attr.temperature;
+	input->lock = control_loop->osc_attr.locked;
+	input->phase_error = (struct timespec) {
+		.tv_sec = control_loop->sign * control_loop->osc_attr.phase_error / NS_IN_SECOND,
+		.tv_nsec = control_loop->sign * control_loop->osc_attr.phase_error % NS_IN_SECOND,
+	};
+	control_loop->phase_error_corrected = control_loop->sign * control_loop->osc_attr.phase_error +
+		(double) input->qErr / 1000;
+
+	if (control_loop->fake_holdover) {
+		log_warn("Fake Holdover activated: make minipod think gnss is not valid");
+		input->valid = false;
+	}
+
+	log_info("input: phase_error = (%lds, %09ldns), "
+		"valid = %s, survey = %s, qErr = %d,lock = %s, fine = %d, "
+		"coarse = %d, temp = %.2f°C, calibration requested: %s",
+		input->phase_error.tv_sec,
+		input->phase_error.tv_nsec,
+		input->valid ? "true" : "false",
+		input->survey_completed ? "true" : "false",
+		input->qErr,
+		input->lock ? "true" : "false",
+		input->fine_setpoint,
+		input->coarse_setpoint,
+		input->temperature,
+		input->calibration_requested ? "true" : "false");
+
+	if (oscillator_calibration_running(&control_loop->calibration)) {
+		/* Disciplining algorithm waits for calibration results */
+		ret = control_loop_calibrate(control_loop, phasemeter_status);
+		if (ret < 0)
+			return ret;
+	} else {
+		/* Call disciplining algorithm process loop */
+		ret = od_process(control_loop->od, input, &control_loop->output);
+		if (ret < 0) {
+			log_error("od_process");
+			return ret;
+		}
+		control_loop->processed++;
+	}
+	/* Resets input structure to empty values */
+	*input = (struct od_input) {0};
+
+	/* Process output result of the algorithm */
+	return control_loop_apply_output(control_loop);
+}
+
+/**
+ * @brief Request a calibration to the algorithm at next step
+ *
+ * @param control_loop
+ */
+void control_loop_request_calibration(struct control_loop *control_loop)
+{
+	control_loop->input.calibration_requested = true;
+	if (control_loop->calibration.state == CALIBRATION_ABORTED)
+		control_loop->calibration.state = CALIBRATION_IDLE;
+}
+
+/**
+ * @brief Abort running calibration, fine control it started from is restored
+ *
+ * @param control_loop
+ */
+void control_loop_abort_calibration(struct control_loop *control_loop)
+{
+	if (oscillator_calibration_running(&control_loop->calibration))
+		oscillator_calibration_abort(control_loop->oscillator, &control_loop->calibration);
+	else
+		log_warn("No calibration running");
+}
+
+/**
+ * @brief Abort running calibration and destroy disciplining algorithm
+ *
+ * @param control_loop
+ */
+void control_loop_cleanup(struct control_loop *control_loop)
+{
+	if (control_loop->oscillator != NULL)
+		oscillator_calibration_abort(control_loop->oscillator, &control_loop->calibration);
+	if (control_loop->od != NULL)
+		od_destroy(&control_loop->od);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file control_loop.h
+ * @brief Disciplining control loop, independent of the devices it runs on
+ * @date 2023-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * One step of the control loop gets the phase error of a pulse, GNSS data
+ * and oscillator attributes, feeds them to the disciplining algorithm or to
+ * the running calibration, and applies the output. Phasemeter, GNSS and
+ * clock are reached through control_loop_ops and the oscillator through its
+ * class, so that the loop can be driven by oscillatord on real devices or
+ * by a simulator in virtual time.
+ */
+#ifndef OSCILLATORD_CONTROL_LOOP_H
+#define OSCILLATORD_CONTROL_LOOP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <oscillator-disciplining/oscillator-disciplining.h>
+
+#include "config.h"
+#include "oscillator.h"
+
+/** Default drift tolerance of adaptive calibration, in ps/s */
+#define CALIBRATION_DRIFT_TOLERANCE_PS 20
+
+/**
+ * @struct control_loop_ops
+ * @brief Devices the control loop gets its inputs from
+ *
+ * All callbacks get the data pointer given to control_loop_init.
+ */
+struct control_loop_ops {
+	/** Wait for next pulse, get its phase error in ns and its TAI second, returns phasemeter status */
+	int (*get_phase_error)(void *data, int64_t *phase_error, int64_t *pps_second);
+	/** Get GNSS fix validity and survey status, 0 on success */
+	int (*get_gnss_epoch)(void *data, bool *valid, bool *survey_completed);
+	/** Get quantization error in ps of pulse of pps_second, 0 if known */
+	int (*get_gnss_qerr)(void *data, int64_t pps_second, int32_t *qErr);
+	/** Shift clock by phase_offset ns */
+	int (*apply_phase_offset)(void *data, int64_t phase_offset);
+	/** Store parameters requested by the algorithm, may be NULL */
+	int (*save_disciplining_parameters)(void *data, struct disciplining_parameters *dsc_params);
+	/** Publish algorithm status when it requests a calibration, may be NULL */
+	void (*calibration_requested)(void *data, const struct od_monitoring *disciplining);
+};
+
+/**
+ * @struct control_loop
+ * @brief State kept between steps, inputs of last step are readable for monitoring
+ */
+struct control_loop {
+	const struct control_loop_ops *ops;
+	void *data;
+	struct oscillator *oscillator;
+	struct od *od;
+	/** -1 if phase error given by phasemeter is opposite to algorithm's one */
+	int sign;
+	struct calibration_settings calibration_settings;
+	struct oscillator_calibration calibration;
+	struct od_input input;
+	struct od_output output;
+	struct oscillator_attributes osc_attr;
+	struct oscillator_ctrl ctrl_values;
+	double phase_error_corrected;
+	bool qerr_matched;
+	/** Number of pulses processed by disciplining algorithm */
+	uint64_t processed;
+	/** Next pulse is measured before phase jump is applied */
+	bool ignore_next_irq;
+	/** Make algorithm think GNSS is not valid */
+	bool fake_holdover;
+};
+
+void control_loop_read_minipod_config(const struct config *config,
+	struct minipod_config *minipod_config);
+int control_loop_init(struct control_loop *control_loop, const struct config *config,
+	struct disciplining_parameters *dsc_params, struct oscillator *oscillator,
+	const struct control_loop_ops *ops, void *data);
+int control_loop_step(struct control_loop *control_loop);
+void control_loop_request_calibration(struct control_loop *control_loop);
+void control_loop_abort_calibration(struct control_loop *control_loop);
+void control_loop_cleanup(struct control_loop *control_loop);
+
+#endif /* OSCILLATORD_CONTROL_LOOP_H */
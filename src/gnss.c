@@ -1,9 +1,12 @@
 #include <errno.h>
-#include <error.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/timex.h>
 #include <time.h>
 #include <unistd.h>
@@ -15,9 +18,11 @@
 #include <ubloxcfg/ff_ubx.h>
 #include <ubloxcfg/ubloxcfg.h>
 
+#include "boot_timeline.h"
 #include "gnss.h"
 #include "gnss-config.h"
 #include "log.h"
+#include "ntpshm_publisher.h"
 #include "utils.h"
 #include "f9_defvalsets.h"
 
@@ -26,7 +31,12 @@
 #define GNSS_CONNECT_MAX_TRY 5
 
 #define GNSS_TIMEOUT_MS 1200
+/** Receiver polling period when its tty cannot be watched */
+#define GNSS_POLL_MS 20
 #define GNSS_RECONFIGURE_MAX_TRY 5
+#define GNSS_DEFAULT_BAUDRATE 460800
+/* Time given to the receiver to switch its UART to a new baudrate */
+#define GNSS_BAUDRATE_SWITCH_US 100000
 #define SEC_IN_WEEK 604800
 
 #define GPS_EPOCH_TO_TAI 315964819
@@ -58,15 +68,6 @@
 /** The resolution of our phasemeter in pico seconds */
 #define QERR_ABS_THRESHOLD_PS 5000
 
-enum AntennaStatus {
-	ANT_STATUS_INIT,
-	ANT_STATUS_DONT_KNOW,
-	ANT_STATUS_OK,
-	ANT_STATUS_SHORT,
-	ANT_STATUS_OPEN,
-	ANT_STATUS_UNDEFINED
-};
-
 enum AntennaPower {
 	ANT_POWER_OFF,
 	ANT_POWER_ON,
@@ -250,15 +251,20 @@ static void gnss_parse_ubx_tim_tp(struct gps_device_t *session, PARSER_MSG_t *ms
 			}
 		}
 
-		session->tai_time = (int) round(
+		/* UBX-TIM-TP gives time and quantization error of next pulse */
+		int64_t pulse_second = (int64_t) round(
 			((double) gr0.towMs / 1000)
 			+ ((double) gr0.week * SEC_IN_WEEK)
 			+ offset
-			- 1 // UBX-TIM-TP gives time at next pulse
 		);
+		session->tai_time = (int) (pulse_second - 1);
 		/* Update quantization error and store quantization of last epoch */
 		session->context->qErr_last_epoch = session->context->qErr;
 		session->context->qErr = gr0.qErr;
+		session->qerr[pulse_second % GNSS_QERR_RING_SIZE] = (struct gnss_qerr) {
+			.tai_second = pulse_second,
+			.qErr = gr0.qErr,
+		};
 		session->tai_time_set = true;
 		return;
 	}
@@ -288,6 +294,10 @@ static enum SurveyInState gnss_parse_ubx_tim_svin(struct gps_device_t *session,
 			);
 		}
 		session->survey_in_position_error = sqrt(gr0.meanV)/1000;
+		session->survey_ecef[0] = gr0.meanX;
+		session->survey_ecef[1] = gr0.meanY;
+		session->survey_ecef[2] = gr0.meanZ;
+		session->survey_mean_v = gr0.meanV;
 		if (!gr0.active && gr0.dur >= SVIN_MIN_DUR)
 			return gr0.valid ? SURVEY_IN_COMPLETED : SURVEY_IN_KO;
 		else if (gr0.dur < SVIN_MAX_DUR)
@@ -360,24 +370,46 @@ static void log_gnss_data(struct gps_device_t *session)
 /**
  * @brief Latch the fact that we've saved a fix and add in the device fudge
  *
- * @param device
+ * Only the active receiver latches its fixes, into the PPS thread of the
+ * card's session, which keeps running after a failover.
+ *
+ * @param gnss
  * @param td
  * Copied from GPSD
  */
-static void ntp_latch(struct gps_device_t *device, struct timedelta_t *td)
+static void ntp_latch(struct gnss *gnss, struct timedelta_t *td)
 {
+    struct gps_device_t *device = gnss->session;
+    struct gps_device_t *ntp;
+    struct ntpshm_publisher *publisher;
 
     /* this should be an invariant of the way this function is called */
     if (0 >= device->last_fix_utc_time.tv_sec) {
         return;
     }
+    if (!__atomic_load_n(&gnss->active, __ATOMIC_ACQUIRE))
+        return;
+    ntp = __atomic_load_n(&gnss->ntp_session, __ATOMIC_ACQUIRE);
+
+    /* PPS thread and PHC publisher use leap seconds of card's context */
+    if (ntp != device) {
+        ntp->context->leap_seconds = device->context->leap_seconds;
+        ntp->context->leap_notify = device->context->leap_notify;
+        ntp->context->lsset = device->context->lsset;
+    }
 
     (void)clock_gettime(CLOCK_REALTIME, &td->clock);
     /* structure copy of time from GPS */
     td->real = device->last_fix_utc_time;
 
     /* thread-safe update */
-    pps_thread_fixin(&device->pps_thread, td);
+    pps_thread_fixin(&ntp->pps_thread, td);
+
+    /* serial time source, only published once receiver has a valid fix */
+    publisher = __atomic_load_n(&ntp->ntpshm_publisher, __ATOMIC_ACQUIRE);
+    if (publisher != NULL && device->valid)
+        ntpshm_publisher_post(publisher, NTPSHM_SOURCE_GNSS, td,
+            device->context->leap_notify);
 }
 
 /**
@@ -482,14 +514,114 @@ static bool set_cable_delay(UBLOXCFG_KEYVAL_t* keyValuePairs, size_t length, con
 	return false;
 }
 
+static bool set_uart_baudrate(UBLOXCFG_KEYVAL_t* keyValuePairs, size_t length, unsigned int baudrate)
+{
+	UBLOXCFG_KEYVAL_t* pair = keyValuePairs + length;
+	while (pair --> keyValuePairs)
+	{
+		if (pair->id == UBLOXCFG_CFG_UART1_BAUDRATE_ID)
+		{
+			pair->val.U4 = baudrate;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Read fingerprint of last configuration applied from state file
+ *
+ * @param path path of the state file
+ * @param fingerprint fingerprint read
+ * @return true if a fingerprint was read
+ */
+static bool gnss_read_config_state(const char *path, uint64_t *fingerprint)
+{
+	FILE *f;
+	bool ret;
+
+	f = fopen(path, "re");
+	if (f == NULL)
+		return false;
+	ret = fscanf(f, "%" SCNx64, fingerprint) == 1;
+	fclose(f);
+	return ret;
+}
+
+/**
+ * @brief Write fingerprint of configuration applied in state file
+ *
+ * @param path path of the state file
+ * @param fingerprint fingerprint to write
+ */
+static void gnss_write_config_state(const char *path, uint64_t fingerprint)
+{
+	FILE *f;
+
+	f = fopen(path, "we");
+	if (f == NULL) {
+		log_warn("Could not write GNSS configuration state in %s: %s", path, strerror(errno));
+		return;
+	}
+	fprintf(f, "%016" PRIx64 "\n", fingerprint);
+	if (fclose(f) != 0)
+		log_warn("Could not write GNSS configuration state in %s: %s", path, strerror(errno));
+}
+
+/** Group of CFG-HW keys, holding antenna supervision and power settings */
+#define CFG_HW_GROUP 0xa3
+
+/**
+ * @brief Compute fingerprint of antenna related keys of a configuration
+ *
+ * Antenna is considered unchanged, and a surveyed position still valid, as
+ * long as cable delay and CFG-HW keys are the same.
+ *
+ * @param kv configuration, sorted by key ID
+ * @param n number of keys
+ * @return fingerprint, 0 on error
+ */
+static uint64_t gnss_antenna_fingerprint(const UBLOXCFG_KEYVAL_t *kv, int n)
+{
+	UBLOXCFG_KEYVAL_t *antenna_kv;
+	uint64_t fingerprint;
+	int count = 0;
+
+	antenna_kv = malloc(n * sizeof(*antenna_kv));
+	if (antenna_kv == NULL)
+		return 0;
+	for (int i = 0; i < n; i++) {
+		if (kv[i].id == UBLOXCFG_CFG_TP_ANT_CABLEDELAY_ID ||
+			((kv[i].id >> 16) & 0xff) == CFG_HW_GROUP)
+			antenna_kv[count++] = kv[i];
+	}
+	fingerprint = gnss_config_fingerprint(antenna_kv, count, "antenna");
+	free(antenna_kv);
+	return fingerprint;
+}
+
 /**
  * @brief Send configuration from f9_defvalsets.h to GNSS receiver
  *
+ * A fingerprint of the configuration and of receiver version is kept in the
+ * receiver and, if gnss-config-state-file is set, in a state file. When they
+ * match, only a few critical keys are checked instead of the whole
+ * configuration.
+ *
  * @param rx pointer to serial communication handler
+ * @param baudrate baudrate UART1 currently uses, kept in configuration, 0 if
+ * unknown
+ * @param version receiver version string
+ * @param state_file file where fingerprint is kept, NULL if disabled
+ * @param antenna_fingerprint output fingerprint of antenna configuration
  * @return boolean indicating receiver has correctly been reset to configuration
  */
-static bool gnss_set_configuration(RX_t* rx, const struct config* config, int major, int minor)
+static bool gnss_set_configuration(RX_t* rx, const struct config* config, int major, int minor,
+	unsigned int baudrate, const char *version, const char *state_file,
+	uint64_t *antenna_fingerprint)
 {
+	uint64_t           state_fingerprint;
+	uint64_t           fingerprint;
 	bool               receiver_configured = false;
 	int                tries               = 0;
 
@@ -499,26 +631,52 @@ static bool gnss_set_configuration(RX_t* rx, const struct config* config, int ma
 
 	set_preferred_time_scale(allKvCfg, nAllKvCfg, config);
 	set_cable_delay(allKvCfg, nAllKvCfg, config);
+	if (baudrate != 0)
+		set_uart_baudrate(allKvCfg, nAllKvCfg, baudrate);
+
+	*antenna_fingerprint = gnss_antenna_fingerprint(allKvCfg, nAllKvCfg);
+	fingerprint = gnss_config_fingerprint(allKvCfg, nAllKvCfg, version);
+	if ((state_file == NULL ||
+		(gnss_read_config_state(state_file, &state_fingerprint) &&
+		state_fingerprint == fingerprint)) &&
+		gnss_config_check_fingerprint(rx, allKvCfg, nAllKvCfg, fingerprint)) {
+		log_info("Receiver configuration fingerprint matches, skipping full check");
+		free(allKvCfg);
+		return true;
+	}
 
-	/* Check if receiver is already configured */
-	receiver_configured = check_gnss_config_in_ram(rx, allKvCfg, nAllKvCfg);
-	if (receiver_configured)
+	/* Only send keys which differ from receiver's current configuration */
+	UBLOXCFG_KEYVAL_t *diffKv = NULL;
+	bool needs_reset = true;
+	int nDiffKv = gnss_config_diff(rx, allKvCfg, nAllKvCfg, &diffKv, &needs_reset);
+	if (nDiffKv == 0) {
 		log_info("Receiver already configured to desired configuration");
-	else
-		log_info("Receiver not configured to desired configuration, starting reconfiguration");
+		receiver_configured = true;
+	} else if (nDiffKv > 0) {
+		log_info("Receiver configuration differs on %d keys, starting reconfiguration", nDiffKv);
+	} else {
+		/* Current configuration is unknown, send all of it */
+		log_info("Receiver configuration unknown, starting reconfiguration");
+		needs_reset = true;
+	}
 
 	while (!receiver_configured) {
 		log_info("Configuring receiver with ART parameters...\n");
-		bool res = rxSetConfig(rx, allKvCfg, nAllKvCfg, true, true, true);
+		bool res = nDiffKv > 0 ?
+			rxSetConfig(rx, diffKv, nDiffKv, true, true, true) :
+			rxSetConfig(rx, allKvCfg, nAllKvCfg, true, true, true);
 
 		if (res) {
 			log_info("Successfully reconfigured GNSS receiver");
-			log_debug("Performing hardware reset");
-			if (!rxReset(rx, RX_RESET_HARD)) {
-				free(allKvCfg);
-				return false;
+			if (needs_reset) {
+				log_debug("Performing hardware reset");
+				if (!rxReset(rx, RX_RESET_HARD)) {
+					free(diffKv);
+					free(allKvCfg);
+					return false;
+				}
+				log_info("hardware reset performed");
 			}
-			log_info("hardware reset performed");
 			receiver_configured = true;
 		}
 
@@ -527,66 +685,409 @@ static bool gnss_set_configuration(RX_t* rx, const struct config* config, int ma
 		else
 		{
 			log_error("Could not configure GNSS receiver\n");
+			free(diffKv);
 			free(allKvCfg);
 			return false;
 		}
 	}
+	free(diffKv);
 	free(allKvCfg);
+
+	if (gnss_config_store_fingerprint(rx, fingerprint)) {
+		if (state_file != NULL)
+			gnss_write_config_state(state_file, fingerprint);
+	} else {
+		log_warn("Could not store configuration fingerprint in receiver");
+	}
+	return true;
+}
+
+/**
+ * @brief Read position of last survey in from state file
+ *
+ * @param path path of the state file
+ * @param antenna_fingerprint fingerprint of antenna configuration of the survey
+ * @param ecef ECEF position in cm
+ * @param acc_mm accuracy of the position in mm
+ * @return true if a position was read
+ */
+static bool gnss_read_survey_state(const char *path, uint64_t *antenna_fingerprint,
+	int32_t ecef[3], uint32_t *acc_mm)
+{
+	FILE *f;
+	bool ret;
+
+	f = fopen(path, "re");
+	if (f == NULL)
+		return false;
+	ret = fscanf(f, "%" SCNx64 " %" SCNd32 " %" SCNd32 " %" SCNd32 " %" SCNu32,
+		antenna_fingerprint, &ecef[0], &ecef[1], &ecef[2], acc_mm) == 5;
+	fclose(f);
+	return ret;
+}
+
+/**
+ * @brief Write position of completed survey in in state file
+ *
+ * Only called by gnss thread
+ *
+ * @param gnss
+ */
+static void gnss_write_survey_state(struct gnss *gnss)
+{
+	struct gps_device_t *session = gnss->session;
+	FILE *f;
+
+	f = fopen(gnss->survey_state_file, "we");
+	if (f == NULL) {
+		log_warn("Could not write GNSS survey state in %s: %s",
+			gnss->survey_state_file, strerror(errno));
+		return;
+	}
+	fprintf(f, "%016" PRIx64 " %" PRId32 " %" PRId32 " %" PRId32 " %" PRIu32 "\n",
+		gnss->antenna_fingerprint, session->survey_ecef[0], session->survey_ecef[1],
+		session->survey_ecef[2], (uint32_t) round(sqrt(session->survey_mean_v)));
+	if (fclose(f) != 0)
+		log_warn("Could not write GNSS survey state in %s: %s",
+			gnss->survey_state_file, strerror(errno));
+	else
+		log_info("GNSS: surveyed position saved in %s", gnss->survey_state_file);
+}
+
+/**
+ * @brief Put receiver in fixed position time mode at position of last survey in
+ *
+ * Position is only written in RAM layer, so that receiver falls back to
+ * survey in of default configuration if oscillatord does not start.
+ *
+ * @param gnss
+ * @return true if receiver uses the position of last survey in
+ */
+static bool gnss_set_fixed_position(struct gnss *gnss)
+{
+	uint64_t antenna_fingerprint;
+	int32_t ecef[3];
+	uint32_t acc_mm;
+
+	if (!gnss_read_survey_state(gnss->survey_state_file, &antenna_fingerprint, ecef, &acc_mm)) {
+		log_info("GNSS: no surveyed position in %s, survey in will be performed",
+			gnss->survey_state_file);
+		return false;
+	}
+	if (antenna_fingerprint != gnss->antenna_fingerprint) {
+		log_info("GNSS: antenna configuration changed since last survey in, survey in will be performed");
+		return false;
+	}
+
+	UBLOXCFG_KEYVAL_t kv[] = {
+		{ .id = UBLOXCFG_CFG_TMODE_MODE_ID, .val.E1 = UBLOXCFG_CFG_TMODE_MODE_FIXED },
+		{ .id = UBLOXCFG_CFG_TMODE_POS_TYPE_ID, .val.E1 = UBLOXCFG_CFG_TMODE_POS_TYPE_ECEF },
+		{ .id = UBLOXCFG_CFG_TMODE_ECEF_X_ID, .val.I4 = ecef[0] },
+		{ .id = UBLOXCFG_CFG_TMODE_ECEF_Y_ID, .val.I4 = ecef[1] },
+		{ .id = UBLOXCFG_CFG_TMODE_ECEF_Z_ID, .val.I4 = ecef[2] },
+		{ .id = UBLOXCFG_CFG_TMODE_ECEF_X_HP_ID, .val.I1 = 0 },
+		{ .id = UBLOXCFG_CFG_TMODE_ECEF_Y_HP_ID, .val.I1 = 0 },
+		{ .id = UBLOXCFG_CFG_TMODE_ECEF_Z_HP_ID, .val.I1 = 0 },
+		/* in 0.1mm */
+		{ .id = UBLOXCFG_CFG_TMODE_FIXED_POS_ACC_ID, .val.U4 = acc_mm * 10 },
+	};
+	if (!rxSetConfig(gnss->rx, kv, ARRAY_SIZE(kv), true, false, false)) {
+		log_warn("GNSS: could not set fixed position, survey in will be performed");
+		return false;
+	}
+
+	log_info("GNSS: using position of last survey in (%d, %d, %d) cm, accuracy %u mm",
+		ecef[0], ecef[1], ecef[2], acc_mm);
+	gnss->session->survey_in_position_error = (float) acc_mm / 1000;
+	gnss->session->survey_completed = true;
 	return true;
 }
 
+/**
+ * @brief Get path of a state file of the receiver from configuration
+ *
+ * Secondary receivers use the path of the configuration suffixed by their
+ * index, so that each receiver has its own files.
+ *
+ * @param config configuration
+ * @param key configuration key of the path
+ * @param index index of the receiver, 0 for the receiver of the card
+ * @param buf buffer where path is written
+ * @param size size of buf
+ * @return path, NULL if not configured
+ */
+static const char *gnss_config_path(const struct config *config, const char *key,
+	unsigned int index, char *buf, size_t size)
+{
+	const char *path = config_get(config, key);
+
+	if (path == NULL)
+		return NULL;
+	if (index == 0)
+		snprintf(buf, size, "%s", path);
+	else
+		snprintf(buf, size, "%s.%u", path, index);
+	return buf;
+}
+
+/**
+ * @brief Get UART baudrate requested in configuration
+ *
+ * @param config configuration
+ * @return baudrate, GNSS_DEFAULT_BAUDRATE if not set or not supported
+ */
+static unsigned int gnss_get_configured_baudrate(const struct config *config)
+{
+	static const unsigned int supported[] = { 115200, 230400, 460800, 921600 };
+	long baudrate;
+
+	if (config_get(config, "gnss-baudrate") == NULL)
+		return GNSS_DEFAULT_BAUDRATE;
+	baudrate = config_get_unsigned_number(config, "gnss-baudrate");
+	for (size_t i = 0; i < ARRAY_SIZE(supported); i++)
+		if (baudrate == supported[i])
+			return baudrate;
+	log_warn("GNSS: unsupported gnss-baudrate %s, using %d",
+		config_get(config, "gnss-baudrate"), GNSS_DEFAULT_BAUDRATE);
+	return GNSS_DEFAULT_BAUDRATE;
+}
+
+/**
+ * @brief Receiver callback, called for each message received
+ */
+static void gnss_capture_message(PARSER_MSG_t *msg, void *arg)
+{
+	gnss_capture_write(arg, msg->data, msg->size);
+}
+
+/**
+ * @brief Set serial communication arguments common to all connections
+ *
+ * @param gnss
+ * @param args arguments to update
+ */
+static void gnss_set_rx_args(struct gnss *gnss, RX_ARGS_t *args)
+{
+	if (gnss->capture != NULL) {
+		args->msgcb = gnss_capture_message;
+		args->cbarg = gnss->capture;
+	}
+}
+
+/**
+ * @brief Open receiver at a given baudrate and check it answers
+ *
+ * @param gnss
+ * @param tty_path device path, without baudrate
+ * @param baudrate baudrate to use
+ * @return serial communication handler, NULL if receiver did not answer
+ */
+static RX_t *gnss_open_at_baudrate(struct gnss *gnss, const char *tty_path, unsigned int baudrate)
+{
+	RX_ARGS_t args = RX_ARGS_DEFAULT();
+	char port[300];
+	char verStr[100];
+	RX_t *rx;
+
+	args.autobaud = false;
+	args.detect = true;
+	gnss_set_rx_args(gnss, &args);
+	snprintf(port, sizeof(port), "%s@%u", tty_path, baudrate);
+	rx = rxInit(port, &args);
+	if (rx == NULL)
+		return NULL;
+	if (!gnss_connect(rx)) {
+		free(rx);
+		return NULL;
+	}
+	if (!rxGetVerStr(rx, verStr, sizeof(verStr))) {
+		rxClose(rx);
+		free(rx);
+		return NULL;
+	}
+	return rx;
+}
+
+/**
+ * @brief Switch receiver's UART1 to a new baudrate
+ *
+ * Baudrate is stored in RAM and BBR layers so that the receiver keeps it on
+ * restart of oscillatord. Receiver is reopened at the new baudrate and must
+ * answer, else communication falls back to the old baudrate.
+ *
+ * @param gnss gnss structure, rx and baudrate are updated on success
+ * @param tty_path device path, without baudrate
+ * @param baudrate new baudrate
+ * @return true if receiver now uses baudrate
+ */
+static bool gnss_switch_baudrate(struct gnss *gnss, const char *tty_path, unsigned int baudrate)
+{
+	UBLOXCFG_KEYVAL_t kv = { .id = UBLOXCFG_CFG_UART1_BAUDRATE_ID, .val.U4 = baudrate };
+	UBLOXCFG_KEYVAL_t old_kv = { .id = UBLOXCFG_CFG_UART1_BAUDRATE_ID, .val.U4 = gnss->baudrate };
+	RX_t *rx;
+
+	log_info("GNSS: switching UART from %u to %u bauds", gnss->baudrate, baudrate);
+	/* Acknowledge may be lost as receiver switches baudrate right after it */
+	if (!rxSetConfig(gnss->rx, &kv, 1, true, true, false))
+		log_debug("GNSS: baudrate change not acknowledged");
+	rxClose(gnss->rx);
+	free(gnss->rx);
+	gnss->rx = NULL;
+	usleep(GNSS_BAUDRATE_SWITCH_US);
+
+	rx = gnss_open_at_baudrate(gnss, tty_path, baudrate);
+	if (rx != NULL) {
+		gnss->rx = rx;
+		gnss->baudrate = baudrate;
+		log_info("GNSS: receiver answers at %u bauds", baudrate);
+		return true;
+	}
+
+	log_warn("GNSS: receiver does not answer at %u bauds, falling back to %u",
+		baudrate, gnss->baudrate);
+	rx = gnss_open_at_baudrate(gnss, tty_path, gnss->baudrate);
+	if (rx == NULL) {
+		log_error("GNSS: receiver does not answer at %u bauds anymore", gnss->baudrate);
+		return false;
+	}
+	gnss->rx = rx;
+	/* Make sure BBR layer does not keep a baudrate that does not work */
+	rxSetConfig(gnss->rx, &old_kv, 1, true, true, false);
+	return false;
+}
+
+/**
+ * @brief Open receiver's tty to be notified of incoming bytes
+ *
+ * Device is only watched by epoll, never read: the input queue of a tty is
+ * shared by all its open file descriptors, data is read by ubloxcfg.
+ *
+ * @param gnss_device_tty device path, optionally followed by @baudrate
+ * @return fd on success, -1 if device is not a local path or cannot be opened
+ */
+static int gnss_open_tty_watch(const char *gnss_device_tty)
+{
+	char path[256];
+	const char *at;
+	size_t len;
+	int fd;
+
+	if (gnss_device_tty[0] != '/')
+		return -1;
+
+	at = strchr(gnss_device_tty, '@');
+	len = at != NULL ? (size_t) (at - gnss_device_tty) : strlen(gnss_device_tty);
+	if (len >= sizeof(path))
+		return -1;
+	memcpy(path, gnss_device_tty, len);
+	path[len] = '\0';
+
+	fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+		log_warn("GNSS: Could not open %s to watch it: %s", path, strerror(errno));
+	return fd;
+}
+
 /**
  * @brief Create gnss struct handler for thread
  *
  * @param config config structure of the program
  * @param session device session structure
  * @param fd_clock file pointer to PHC
- * @return struct gnss*
+ * @return struct gnss*, NULL with errno set on error
  */
-struct gnss * gnss_init(const struct config *config, char *gnss_device_tty, struct gps_device_t *session, int fd_clock)
+struct gnss * gnss_init(const struct config *config, char *gnss_device_tty, struct gps_device_t *session,
+	int fd_clock, unsigned int index)
 {
 	struct gnss* gnss;
-	int          ret  = -1;
+	int          ret  = -ENODEV;
 	RX_ARGS_t    args = RX_ARGS_DEFAULT();
+	char         tty_path[256];
+	char         path[PATH_MAX];
+	unsigned int baudrate;
+	const char   *capture_path;
+	const char   *state_file;
+	char         *at;
 	args.autobaud     = true;
 	args.detect       = true;
 
-	if (strchr(gnss_device_tty, '@')) {
-		args.autobaud = false;
-	}
-
 	if (session == NULL) {
 		log_error("No gps session provided");
+		errno = EINVAL;
 		return NULL;
 	}
 
 	gnss = (struct gnss *) malloc(sizeof(struct gnss));
 	if (gnss == NULL) {
 		log_error("could not allocate memory for gnss");
+		errno = ENOMEM;
 		return NULL;
 	}
 
+	snprintf(tty_path, sizeof(tty_path), "%s", gnss_device_tty);
+	at = strchr(tty_path, '@');
+	if (at != NULL) {
+		args.autobaud = false;
+		*at = '\0';
+		gnss->baudrate = strtoul(at + 1, NULL, 10);
+	} else {
+		gnss->baudrate = 0;
+	}
+	baudrate = gnss_get_configured_baudrate(config);
+
+	gnss->index = index;
+	gnss->gnss_info = NULL;
+	gnss->active = index == 0;
+	gnss->ntp_session = session;
+	gnss->capture = NULL;
+	capture_path = gnss_config_path(config, "gnss-capture-file", index, path, sizeof(path));
+	if (capture_path != NULL) {
+		gnss->capture = gnss_capture_open(capture_path);
+		if (gnss->capture == NULL)
+			log_warn("GNSS: receiver data will not be captured");
+	}
+	gnss_set_rx_args(gnss, &args);
+
 	gnss->fd_clock = fd_clock;
 	gnss->session = session;
 	gnss_reset_session_navigation_data(gnss->session);
 	/* Init Antenna Status and Power to undefined values according to UBX Protocol */
 	gnss->session->antenna_status = ANT_STATUS_UNDEFINED;
 	gnss->session->antenna_power = ANT_POWER_UNDEFINED;
-	gnss->rx = rxInit(gnss_device_tty, &args);
 	gnss->action = GNSS_ACTION_NONE;
 	/* Init Survey In Error to undefined values */
 	gnss->session->survey_in_position_error =-1.0;
 	/* Init receiver version values */
 	gnss->receiver_version_minor = -1;
 	gnss->receiver_version_major = -1;
-	if (gnss->rx == NULL)
-		goto err_rxInit;
 
-	if (!gnss_connect(gnss->rx))
-		goto err_gnss_connect;
+	/* Receiver may still use the baudrate negotiated by a previous run */
+	gnss->rx = NULL;
+	if (gnss->baudrate != 0 && baudrate != gnss->baudrate) {
+		gnss->rx = gnss_open_at_baudrate(gnss, tty_path, baudrate);
+		if (gnss->rx != NULL)
+			gnss->baudrate = baudrate;
+	}
+
+	if (gnss->rx == NULL) {
+		gnss->rx = rxInit(gnss_device_tty, &args);
+		if (gnss->rx == NULL)
+			goto err_rxInit;
+
+		if (!gnss_connect(gnss->rx)) {
+			log_error("Could not connect to GNSS serial at %s", gnss_device_tty);
+			goto err_free_rx;
+		}
+
+		if (gnss->baudrate != 0 && baudrate != gnss->baudrate &&
+			!gnss_switch_baudrate(gnss, tty_path, baudrate) && gnss->rx == NULL)
+			goto err_rxInit;
+	}
+	if (gnss->baudrate != 0)
+		log_info("GNSS: receiver UART at %u bauds", gnss->baudrate);
 
 	/* Fetch receiver version and save it in gnss structure*/
-	char verStr[100];
+	char verStr[100] = "";
     if (rxGetVerStr(gnss->rx, verStr, sizeof(verStr))) {
 		if (parse_receiver_version(verStr, &gnss->receiver_version_major, &gnss->receiver_version_minor))
 			log_debug("Receiver version successfully detected ! Major is %d, Minor is %d ", gnss->receiver_version_major, gnss->receiver_version_minor);
@@ -596,8 +1097,13 @@ struct gnss * gnss_init(const struct config *config, char *gnss_device_tty, stru
 	else
 		log_warn("Receiver version get command failed");
 
-	if (!gnss_set_configuration(gnss->rx, config, gnss->receiver_version_major, gnss->receiver_version_minor))
-		goto err_gnss_connect;
+	state_file = gnss_config_path(config, "gnss-config-state-file", index, path, sizeof(path));
+	if (!gnss_set_configuration(gnss->rx, config, gnss->receiver_version_major,
+		gnss->receiver_version_minor, gnss->baudrate, verStr, state_file,
+		&gnss->antenna_fingerprint)) {
+		log_error("Could not configure GNSS receiver at %s", gnss_device_tty);
+		goto err_close_rx;
+	}
 
 	gnss->stop = false;
 
@@ -614,14 +1120,41 @@ struct gnss * gnss_init(const struct config *config, char *gnss_device_tty, stru
 		log_warn("Please note that performance may be degraded and holdover might not reached specified limits");
 	}
 
+	/* Reuse position of last survey in unless a new one is requested */
+	gnss->fixed_position = false;
+	gnss->survey_state_file[0] = '\0';
+	if (gnss_config_path(config, "gnss-survey-state-file", index,
+		gnss->survey_state_file, sizeof(gnss->survey_state_file)) != NULL) {
+		if (config_get_bool_default(config, "gnss-force-survey", false))
+			log_info("GNSS: survey in forced by configuration");
+		else
+			gnss->fixed_position = gnss_set_fixed_position(gnss);
+	}
+
 	if (!rxReset(gnss->rx, RX_RESET_GNSS_START)) {
 		log_error("Could not start GNSS receiver");
-		goto err_gnss_connect;
+		goto err_close_rx;
 	}
 
+	gnss->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (gnss->event_fd < 0) {
+		log_error("Could not create GNSS event fd: %s", strerror(errno));
+		ret = -errno;
+		goto err_close_rx;
+	}
+	/* Watched by gnss thread */
+	snprintf(gnss->tty, sizeof(gnss->tty), "%s", gnss_device_tty);
+	gnss->tty_fd = -1;
+	gnss->epoll_fd = -1;
+
 	pthread_mutex_init(&gnss->mutex_data, NULL);
-	pthread_cond_init(&gnss->cond_time, NULL);
 	pthread_cond_init(&gnss->cond_data, NULL);
+	gnss->epoch_seq = 0;
+	gnss->epoch_number = 0;
+	memset(gnss->msg_stats, 0, sizeof(gnss->msg_stats));
+	memset(&gnss->msg_stats_published, 0, sizeof(gnss->msg_stats_published));
+	memset(&gnss->sky, 0, sizeof(gnss->sky));
+	memset(&gnss->epoch, 0, sizeof(gnss->epoch));
 
 	ret = pthread_create(
 		&gnss->thread,
@@ -631,21 +1164,132 @@ struct gnss * gnss_init(const struct config *config, char *gnss_device_tty, stru
 	);
 
 	if (ret != 0) {
-		rxClose(gnss->rx);
-		goto err_gnss_connect;
+		ret = -ret;
+		log_error("Could not create GNSS thread: %s", strerror(-ret));
+		close(gnss->event_fd);
+		goto err_close_rx;
 	}
 
 	return gnss;
 
-err_gnss_connect:
+err_close_rx:
+	/* Release the port so that it can be used again */
+	rxClose(gnss->rx);
+err_free_rx:
 	free(gnss->rx);
-	log_error("Could not connect to GNSS serial at %s", gnss_device_tty);
 err_rxInit:
+	gnss_capture_close(&gnss->capture);
 	free(gnss);
-	error(EXIT_FAILURE, -ret, "gnss_init");
+	/* Caller decides whether receiver is required */
+	errno = -ret;
 	return NULL;
 }
 
+/**
+ * @brief Publish current session data as a new epoch and wake up waiters
+ *
+ * Only called by gnss thread
+ *
+ * @param gnss
+ */
+static void gnss_publish_epoch(struct gnss *gnss)
+{
+	struct gps_device_t *session = gnss->session;
+	struct gnss_epoch *epoch = &gnss->epoch;
+	uint32_t seq = gnss->epoch_seq;
+	uint64_t number = gnss->epoch_number + 1;
+
+	__atomic_store_n(&gnss->epoch_seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	epoch->number = number;
+	epoch->valid = session->valid;
+	epoch->fix = session->fix;
+	epoch->fixOk = session->fixOk;
+	epoch->satellites_count = session->satellites_count;
+	epoch->last_fix_utc_time = session->last_fix_utc_time;
+	epoch->tai_time_set = session->tai_time_set;
+	epoch->tai_time = session->tai_time;
+	epoch->qErr = session->context->qErr;
+	epoch->qErr_last_epoch = session->context->qErr_last_epoch;
+	memcpy(epoch->qerr, session->qerr, sizeof(epoch->qerr));
+	epoch->survey_completed = session->survey_completed;
+	epoch->survey_in_position_error = session->survey_in_position_error;
+	epoch->lsset = session->context->lsset;
+	epoch->leap_seconds = session->context->leap_seconds;
+	epoch->lsChange = session->context->lsChange;
+	epoch->leap_notify = session->context->leap_notify;
+	epoch->antenna_status = session->antenna_status;
+	epoch->antenna_power = session->antenna_power;
+
+	__atomic_store_n(&gnss->epoch_seq, seq + 2, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&gnss->mutex_data);
+	__atomic_store_n(&gnss->epoch_number, number, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&gnss->cond_data);
+	pthread_mutex_unlock(&gnss->mutex_data);
+
+	/* Only the receiver disciplining the clock counts for start up */
+	if (__atomic_load_n(&gnss->active, __ATOMIC_ACQUIRE)) {
+		if (epoch->tai_time_set)
+			boot_timeline_mark(BOOT_TAI_TIME);
+		if (epoch->survey_completed)
+			boot_timeline_mark(BOOT_SURVEY_DONE);
+	}
+}
+
+/**
+ * @brief Copy last epoch published without waiting
+ *
+ * Epoch number is 0 if no epoch has been published yet
+ *
+ * @param gnss
+ * @param epoch Output last epoch
+ */
+void gnss_get_last_epoch(struct gnss *gnss, struct gnss_epoch *epoch)
+{
+	uint32_t before;
+
+	do {
+		before = __atomic_load_n(&gnss->epoch_seq, __ATOMIC_ACQUIRE);
+		if (before & 1)
+			continue;
+		memcpy(epoch, &gnss->epoch, sizeof(*epoch));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((before & 1) || __atomic_load_n(&gnss->epoch_seq, __ATOMIC_RELAXED) != before);
+}
+
+/**
+ * @brief Get first epoch published after epoch number after
+ *
+ * Returns immediately if such an epoch is already available, else waits for
+ * gnss thread to publish it.
+ *
+ * @param gnss
+ * @param after Number of the last epoch known by the caller, 0 for none
+ * @param epoch Output epoch
+ * @return int 0 on success, -1 if gnss is NULL or being stopped
+ */
+int gnss_get_epoch(struct gnss *gnss, uint64_t after, struct gnss_epoch *epoch)
+{
+	if (!gnss)
+		return -1;
+
+	if (__atomic_load_n(&gnss->epoch_number, __ATOMIC_ACQUIRE) <= after) {
+		pthread_mutex_lock(&gnss->mutex_data);
+		while (gnss->epoch_number <= after && !gnss->stop)
+			pthread_cond_wait(&gnss->cond_data, &gnss->mutex_data);
+		if (gnss->epoch_number <= after) {
+			pthread_mutex_unlock(&gnss->mutex_data);
+			return -1;
+		}
+		pthread_mutex_unlock(&gnss->mutex_data);
+	}
+
+	gnss_get_last_epoch(gnss, epoch);
+	return 0;
+}
+
 /**
  * @brief Wait for next TAI time retrieved from the device
  *
@@ -654,17 +1298,47 @@ err_rxInit:
  */
 static time_t gnss_get_next_fix_tai_time(struct gnss * gnss)
 {
-	time_t time;
-	pthread_mutex_lock(&gnss->mutex_data);
-	pthread_cond_wait(&gnss->cond_time, &gnss->mutex_data);
-	time = gnss->session->tai_time;
-	pthread_mutex_unlock(&gnss->mutex_data);
-	return time;
+	struct gnss_epoch epoch;
+	uint64_t number = __atomic_load_n(&gnss->epoch_number, __ATOMIC_ACQUIRE);
+
+	do {
+		if (gnss_get_epoch(gnss, number, &epoch) != 0)
+			return 0;
+		number = epoch.number;
+	} while (!epoch.tai_time_set);
 
+	return epoch.tai_time;
 }
 
 /**
- * @brief Get GNSS data from epoch
+ * @brief Get quantization error of the pulse emitted at a TAI second
+ *
+ * Does not wait for a new epoch: UBX-TIM-TP of a pulse is received during
+ * the second preceding it, so it is known once the pulse has been timestamped.
+ *
+ * @param gnss
+ * @param tai_second TAI second of the pulse, as timestamped by the PHC
+ * @param qErr Output Quantization error in picoseconds
+ * @return 0 on success, -ENOENT if no UBX-TIM-TP describes this pulse
+ */
+int gnss_get_qerr(struct gnss *gnss, int64_t tai_second, int32_t *qErr)
+{
+	struct gnss_epoch epoch;
+	const struct gnss_qerr *entry;
+
+	if (!gnss || tai_second <= 0)
+		return -EINVAL;
+
+	gnss_get_last_epoch(gnss, &epoch);
+	entry = &epoch.qerr[tai_second % GNSS_QERR_RING_SIZE];
+	if (entry->tai_second != tai_second)
+		return -ENOENT;
+	*qErr = entry->qErr;
+	return 0;
+}
+
+/**
+ * @brief Get GNSS data from next epoch
  *
  * @param gnss
  * @param valid Output Flags indicating GNSS data are valid (Fix >= 2D + FixOk)
@@ -672,24 +1346,25 @@ static time_t gnss_get_next_fix_tai_time(struct gnss * gnss)
  */
 int gnss_get_epoch_data(struct gnss *gnss, bool *valid, bool *survey, int32_t *qErr)
 {
+	struct gnss_epoch epoch;
+
 	if (!gnss) {
 		return -1;
 	}
 
-	pthread_mutex_lock(&gnss->mutex_data);
-	pthread_cond_wait(&gnss->cond_data, &gnss->mutex_data);
+	if (gnss_get_epoch(gnss, __atomic_load_n(&gnss->epoch_number, __ATOMIC_ACQUIRE), &epoch) != 0)
+		return -1;
 	if (survey != NULL)
-		*survey = gnss->session->survey_completed;
+		*survey = epoch.survey_completed;
 	if (valid != NULL)
-		*valid = gnss->session->valid;
+		*valid = epoch.valid;
 	if (qErr != NULL)
-		*qErr = gnss->session->context->qErr_last_epoch;
-	pthread_mutex_unlock(&gnss->mutex_data);
+		*qErr = epoch.qErr_last_epoch;
 	return 0;
 }
 
 /**
- * @brief Get GNSS data from epoch
+ * @brief Get GNSS data from next epoch
  *
  * @param gnss
  * @param valid Output Flags indicating GNSS data are valid (Fix >= 2D + FixOk)
@@ -697,17 +1372,18 @@ int gnss_get_epoch_data(struct gnss *gnss, bool *valid, bool *survey, int32_t *q
  */
 int gnss_get_fix_info(struct gnss *gnss, bool *valid, struct timespec *fixUtc)
 {
+	struct gnss_epoch epoch;
+
 	if (!gnss) {
 		return -1;
 	}
 
-	pthread_mutex_lock(&gnss->mutex_data);
-	pthread_cond_wait(&gnss->cond_data, &gnss->mutex_data);
+	if (gnss_get_epoch(gnss, __atomic_load_n(&gnss->epoch_number, __ATOMIC_ACQUIRE), &epoch) != 0)
+		return -1;
 	if (valid != NULL)
-		*valid = gnss->session->valid;
+		*valid = epoch.valid;
 	if (fixUtc != NULL)
-		*fixUtc = gnss->session->last_fix_utc_time;
-	pthread_mutex_unlock(&gnss->mutex_data);
+		*fixUtc = epoch.last_fix_utc_time;
 	return 0;
 }
 
@@ -834,184 +1510,599 @@ static bool reset_serial(RX_t* rx)
 	return false;
 }
 
+/**
+ * @brief Watch receiver's tty in gnss thread's epoll instance
+ *
+ * Receiver is polled every GNSS_POLL_MS if its tty cannot be watched.
+ *
+ * @param gnss
+ */
+static void gnss_watch_tty(struct gnss *gnss)
+{
+	struct epoll_event event = { .events = EPOLLIN };
+
+	gnss->tty_fd = gnss_open_tty_watch(gnss->tty);
+	if (gnss->tty_fd >= 0) {
+		event.data.fd = gnss->tty_fd;
+		if (epoll_ctl(gnss->epoll_fd, EPOLL_CTL_ADD, gnss->tty_fd, &event) == 0)
+			return;
+		log_warn("GNSS: Could not watch receiver tty: %s", strerror(errno));
+		close(gnss->tty_fd);
+		gnss->tty_fd = -1;
+	}
+	log_warn("GNSS: polling receiver every %d ms", GNSS_POLL_MS);
+}
+
+static void gnss_unwatch_tty(struct gnss *gnss)
+{
+	if (gnss->tty_fd < 0)
+		return;
+	/* Closing the last fd on the tty also removes it from epoll */
+	close(gnss->tty_fd);
+	gnss->tty_fd = -1;
+}
+
+/**
+ * @brief Reset serial connection, device is fully released in between
+ *
+ * Only called by gnss thread
+ *
+ * @param gnss
+ */
+static bool gnss_reset_serial(struct gnss *gnss)
+{
+	bool ret;
+
+	gnss_unwatch_tty(gnss);
+	ret = reset_serial(gnss->rx);
+	gnss_watch_tty(gnss);
+	return ret;
+}
+
+/**
+ * @brief Handle UBX-MON-RF to get antenna status
+ */
+static void gnss_handle_mon_rf(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	struct gps_device_t *session = gnss->session;
+
+	gnss_get_antenna_data(session, msg);
+	log_trace("GNSS: Antenna status: 0x%x", session->antenna_status);
+	log_trace("GNSS: Power status: 0x%x", session->antenna_power);
+	if (session->antenna_power == UBX_MON_RF_V0_ANTPOWER_OFF) {
+		/* Antenna power is off, hence this is the only message we will get on the serial
+		 * We need to signal main thread that we do not have fix nor satellite count
+		 * Reset data because we cannot assume either of these
+		 */
+		gnss_reset_session_navigation_data(session);
+		gnss_publish_epoch(gnss);
+	}
+}
+
+/**
+ * @brief Handle UBX-NAV-TIMELS, library does not parse it
+ */
+static void gnss_handle_nav_timels(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	gnss_parse_ubx_nav_timels(gnss->session, msg);
+}
+
+/**
+ * @brief Handle UBX-TIM-TP to get TAI time and quantization error
+ */
+static void gnss_handle_tim_tp(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	gnss_parse_ubx_tim_tp(gnss->session, msg);
+}
+
+/**
+ * @brief Handle UBX-TIM-SVIN to follow Survey In
+ */
+static void gnss_handle_tim_svin(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	struct gps_device_t *session = gnss->session;
+	enum SurveyInState surveyInState;
+
+	/* No survey in is running, keep accuracy of the position used */
+	if (gnss->fixed_position)
+		return;
+
+	surveyInState = gnss_parse_ubx_tim_svin(session, msg);
+	if (!session->survey_completed && !session->bypass_survey) {
+		switch (surveyInState) {
+		case SURVEY_IN_COMPLETED:
+			session->survey_completed = true;
+			if (gnss->survey_state_file[0] != '\0')
+				gnss_write_survey_state(gnss);
+			break;
+		case SURVEY_IN_IN_PROGRESS:
+		case SURVEY_IN_UNKNOWN:
+			break;
+		case SURVEY_IN_KO:
+		default:
+			log_error("Survey In did not complete in time. GNSS conditions are not stable enough for optimal timing performance");
+			log_error("Please check your antenna setup (antenna on roof is way more precise) to pass survey in.");
+			break;
+		}
+	}
+}
+
+static unsigned int gnss_sky_cno_bin(uint8_t cno)
+{
+	unsigned int bin = cno / 10;
+
+	return bin < GNSS_SKY_CNO_BINS ? bin : GNSS_SKY_CNO_BINS - 1;
+}
+
+static unsigned int gnss_sky_elev_bin(int8_t elev)
+{
+	if (elev < 0)
+		return 0;
+	if (elev < 15)
+		return 1;
+	if (elev < 30)
+		return 2;
+	if (elev < 60)
+		return 3;
+	return 4;
+}
+
+/**
+ * @brief Handle UBX-NAV-SAT to rebuild per constellation satellites table
+ */
+static void gnss_handle_nav_sat(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	UBX_NAV_SAT_V1_GROUP0_t gr0;
+	struct gnss_sky *sky = &gnss->sky;
+
+	if (msg->size < (int) UBX_NAV_SAT_V1_MIN_SIZE ||
+		UBX_NAV_SAT_VERSION_GET(msg->data) != UBX_NAV_SAT_V1_VERSION)
+		return;
+	memcpy(&gr0, &msg->data[UBX_HEAD_SIZE], sizeof(gr0));
+	if ((int) (UBX_NAV_SAT_V1_MIN_SIZE + gr0.numSvs * sizeof(UBX_NAV_SAT_V1_GROUP1_t)) > msg->size)
+		return;
+
+	memset(sky->sats, 0, sizeof(sky->sats));
+	for (int i = 0; i < gr0.numSvs; i++) {
+		UBX_NAV_SAT_V1_GROUP1_t sv;
+		struct gnss_sky_sat *sat;
+		unsigned int elev;
+
+		memcpy(&sv, &msg->data[UBX_HEAD_SIZE + sizeof(gr0) + i * sizeof(sv)], sizeof(sv));
+		if (sv.gnssId >= GNSS_SKY_GNSS_MAX || sv.cno == 0)
+			continue;
+		sat = &sky->sats[sv.gnssId];
+		elev = gnss_sky_elev_bin(sv.elev);
+		sat->tracked++;
+		sat->cno_sum += sv.cno;
+		sat->cno[gnss_sky_cno_bin(sv.cno)]++;
+		sat->elev[elev]++;
+		if (sv.flags & UBX_NAV_SAT_V1_FLAGS_SVUSED) {
+			sat->used++;
+			sat->used_elev[elev]++;
+		}
+	}
+	sky->sat_itow = gr0.iTOW;
+	sky->sat_updates++;
+}
+
+/**
+ * @brief Handle UBX-NAV-SIG to rebuild per signal table
+ */
+static void gnss_handle_nav_sig(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	UBX_NAV_SIG_V0_GROUP0_t gr0;
+	struct gnss_sky *sky = &gnss->sky;
+
+	if (msg->size < (int) UBX_NAV_SIG_V0_MIN_SIZE ||
+		UBX_NAV_SIG_VERSION_GET(msg->data) != UBX_NAV_SIG_V0_VERSION)
+		return;
+	memcpy(&gr0, &msg->data[UBX_HEAD_SIZE], sizeof(gr0));
+	if ((int) (UBX_NAV_SIG_V0_MIN_SIZE + gr0.numSigs * sizeof(UBX_NAV_SIG_V0_GROUP1_t)) > msg->size)
+		return;
+
+	memset(sky->sigs, 0, sizeof(sky->sigs));
+	for (int i = 0; i < gr0.numSigs; i++) {
+		UBX_NAV_SIG_V0_GROUP1_t sig;
+		struct gnss_sky_sig *entry;
+
+		memcpy(&sig, &msg->data[UBX_HEAD_SIZE + sizeof(gr0) + i * sizeof(sig)], sizeof(sig));
+		if (sig.gnssId >= GNSS_SKY_GNSS_MAX || sig.sigId >= GNSS_SKY_SIG_MAX || sig.cno == 0)
+			continue;
+		entry = &sky->sigs[sig.gnssId][sig.sigId];
+		entry->tracked++;
+		entry->cno_sum += sig.cno;
+		entry->cno[gnss_sky_cno_bin(sig.cno)]++;
+		if (sig.sigFlags & UBX_NAV_SIG_V0_SIGFLAGS_PR_USED)
+			entry->used++;
+	}
+	sky->sig_itow = gr0.iTOW;
+	sky->sig_updates++;
+}
+
+#define UBX_KEY(cls, id) ((uint16_t) (((cls) << 8) | (id)))
+
+typedef void (*gnss_msg_handler_t)(struct gnss *gnss, PARSER_MSG_t *msg);
+
+/**
+ * @struct gnss_msg_handler
+ * @brief Handler of a UBX message not consumed by the epoch collector
+ */
+struct gnss_msg_handler {
+	uint16_t key;
+	gnss_msg_handler_t handler;
+};
+
+/** Message handlers, must be sorted by key */
+static const struct gnss_msg_handler gnss_msg_handlers[] = {
+	{ UBX_KEY(UBX_NAV_CLSID, UBX_NAV_TIMELS_MSGID), gnss_handle_nav_timels },
+	{ UBX_KEY(UBX_NAV_CLSID, UBX_NAV_SAT_MSGID), gnss_handle_nav_sat },
+	{ UBX_KEY(UBX_NAV_CLSID, UBX_NAV_SIG_MSGID), gnss_handle_nav_sig },
+	{ UBX_KEY(UBX_MON_CLSID, UBX_MON_RF_MSGID), gnss_handle_mon_rf },
+	{ UBX_KEY(UBX_TIM_CLSID, UBX_TIM_TP_MSGID), gnss_handle_tim_tp },
+	{ UBX_KEY(UBX_TIM_CLSID, UBX_TIM_SVIN_MSGID), gnss_handle_tim_svin },
+};
+
+static int gnss_msg_handler_cmp(const void *key, const void *entry)
+{
+	return (int) *(const uint16_t *) key -
+		(int) ((const struct gnss_msg_handler *) entry)->key;
+}
+
+/**
+ * @brief Find the handler of a message
+ *
+ * @param key (class << 8 | id) of the message
+ * @return handler, NULL if message is not handled
+ */
+static gnss_msg_handler_t gnss_find_msg_handler(uint16_t key)
+{
+	const struct gnss_msg_handler *entry = bsearch(&key, gnss_msg_handlers,
+		ARRAY_SIZE(gnss_msg_handlers), sizeof(gnss_msg_handlers[0]),
+		gnss_msg_handler_cmp);
+
+	return entry != NULL ? entry->handler : NULL;
+}
+
+/**
+ * @brief Process a message received from the receiver
+ *
+ * @param gnss
+ * @param coll epoch collector
+ * @param msg message received
+ */
+static void gnss_process_message(struct gnss *gnss, EPOCH_t *coll, PARSER_MSG_t *msg)
+{
+	struct gps_device_t *session = gnss->session;
+	EPOCH_t epoch;
+
+	// Epoch collect is used to fetch navigation data such as time and leap seconds
+	if(epochCollect(coll, msg, &epoch))
+	{
+		// if epoch has no fix there will be no Nav solution and 0 satellites
+		session->satellites_count = gnss_get_satellites(&epoch);
+		if (epoch.haveFix) {
+			session->last_fix_utc_time.tv_sec = gnss_get_utc_time(&epoch);
+			session->fix = epoch.fix;
+			session->fixOk = epoch.fixOk && session->satellites_count > NUM_SAT_MIN;
+			session->valid = session->fix >= EPOCH_FIX_TIME && session->fixOk;
+			if (!session->valid) {
+				if (session->fix < EPOCH_FIX_TIME)
+					log_trace("Fix is to low: %d", session->fix);
+				if (!session->fixOk)
+					log_trace("Fix is not OK");
+			}
+			struct timedelta_t td;
+			ntp_latch(gnss, &td);
+			log_gnss_data(session);
+		} else {
+			session->fix = NO_FIX;
+			session->fixOk = false;
+		}
+		gnss_publish_epoch(gnss);
+
+		if (!session->tai_time_set)
+			log_warn("Could not tai time from gnss, please check GNSS Configuration if this message keeps appearing more than 25 minutes");
+
+	} else if (msg->type == PARSER_MSGTYPE_UBX) {
+		gnss_msg_handler_t handler = gnss_find_msg_handler(
+			UBX_KEY(UBX_CLSID(msg->data), UBX_MSGID(msg->data)));
+		if (handler != NULL)
+			handler(gnss, msg);
+	}
+}
+
+/**
+ * @brief Get counters entry of a message, creating it if needed
+ *
+ * @param gnss
+ * @param msg message received
+ * @return counters entry, NULL if table is full
+ */
+static struct gnss_msg_stats *gnss_get_msg_stats(struct gnss *gnss, PARSER_MSG_t *msg)
+{
+	uint16_t key;
+	unsigned int index;
+
+	if (msg->type == PARSER_MSGTYPE_UBX)
+		key = UBX_KEY(UBX_CLSID(msg->data), UBX_MSGID(msg->data));
+	else
+		key = GNSS_MSG_KEY_OTHER(msg->type);
+
+	/* Open addressing, table is small and never shrinks */
+	index = (key * 40503u) % GNSS_MSG_STATS_MAX;
+	for (int i = 0; i < GNSS_MSG_STATS_MAX; i++) {
+		struct gnss_msg_stats *stats = &gnss->msg_stats[(index + i) % GNSS_MSG_STATS_MAX];
+		if (stats->key == key)
+			return stats;
+		if (stats->key == 0) {
+			stats->key = key;
+			if (msg->type == PARSER_MSGTYPE_UBX && msg->name != NULL)
+				strncpy(stats->name, msg->name, sizeof(stats->name) - 1);
+			else if (msg->type == PARSER_MSGTYPE_NMEA)
+				strcpy(stats->name, "NMEA");
+			else if (msg->type == PARSER_MSGTYPE_RTCM3)
+				strcpy(stats->name, "RTCM3");
+			else
+				strcpy(stats->name, "GARBAGE");
+			return stats;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Process a message and account its size and processing time
+ *
+ * @param gnss
+ * @param coll epoch collector
+ * @param msg message received
+ */
+static void gnss_process_message_timed(struct gnss *gnss, EPOCH_t *coll, PARSER_MSG_t *msg)
+{
+	struct gnss_msg_stats *stats = gnss_get_msg_stats(gnss, msg);
+	struct timespec start;
+	struct timespec end;
+	uint64_t ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	gnss_process_message(gnss, coll, msg);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (stats == NULL)
+		return;
+	ns = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+	if (stats->count == 0)
+		stats->first = start;
+	stats->last = start;
+	stats->count++;
+	stats->bytes += msg->size;
+	stats->parse_ns += ns;
+	if (ns > stats->max_parse_ns)
+		stats->max_parse_ns = ns > UINT32_MAX ? UINT32_MAX : ns;
+}
+
+/**
+ * @brief Get milliseconds elapsed since a monotonic time
+ */
+static int64_t gnss_elapsed_ms(const struct timespec *since)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec) * 1000 +
+		(now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/**
+ * @brief Copy session data to monitoring's gnss state
+ *
+ * @param gnss
+ */
+static void gnss_update_monitoring(struct gnss *gnss)
+{
+	/* Monitoring may be moved to another receiver by the selector */
+	struct gnss_state *gnss_info = __atomic_load_n(&gnss->gnss_info, __ATOMIC_ACQUIRE);
+
+	/* this thread is the only user of gnss->session, no lock is needed to read it */
+	if (gnss_info) {
+		bool publish_stats = gnss_elapsed_ms(&gnss->msg_stats_published) >= 1000;
+
+		pthread_mutex_lock(&gnss_info->lock);
+		if (publish_stats) {
+			memcpy(gnss_info->msg_stats, gnss->msg_stats, sizeof(gnss->msg_stats));
+			gnss_info->sky = gnss->sky;
+		}
+		gnss_info->antenna_power = gnss->session->antenna_power;
+		gnss_info->antenna_status = gnss->session->antenna_status;
+		gnss_info->fix = gnss->session->fix;
+		gnss_info->fixOk = gnss->session->fixOk;
+		gnss_info->leap_seconds = gnss->session->context->leap_seconds;
+		gnss_info->lsChange = gnss->session->context->lsChange;
+		gnss_info->satellites_count = gnss->session->satellites_count;
+		gnss_info->survey_in_position_error = gnss->session->survey_in_position_error;
+		pthread_mutex_unlock(&gnss_info->lock);
+		if (publish_stats)
+			clock_gettime(CLOCK_MONOTONIC, &gnss->msg_stats_published);
+	}
+}
+
+/**
+ * @brief Put receiver back in fixed position mode after a reset reloaded its configuration
+ *
+ * If position cannot be set again, survey in is tracked again.
+ *
+ * @param gnss
+ */
+static void gnss_restore_fixed_position(struct gnss *gnss)
+{
+	if (!gnss->fixed_position)
+		return;
+	gnss->fixed_position = gnss_set_fixed_position(gnss);
+	if (!gnss->fixed_position)
+		gnss->session->survey_completed = false;
+}
+
+/**
+ * @brief Perform action requested on the receiver
+ *
+ * @param gnss
+ * @param action action to perform
+ */
+static void gnss_handle_action(struct gnss *gnss, enum gnss_action action)
+{
+	if (action == GNSS_ACTION_START) {
+		log_debug("Performing GNSS START");
+		if (!rxReset(gnss->rx, RX_RESET_GNSS_START))
+			log_error("Could not start GNSS Receiver");
+		else
+			log_info("GNSS START performed");
+	} else if (action == GNSS_ACTION_STOP) {
+		log_debug("Performing GNSS STOP");
+		if (!rxReset(gnss->rx, RX_RESET_GNSS_STOP))
+			log_error("Could not stop GNSS Receiver");
+		else
+			log_info("GNSS STOP performed");
+	} else if (action == GNSS_ACTION_SOFT) {
+		log_debug("Performing GNSS SOFT RESET");
+		if (!rxReset(gnss->rx, RX_RESET_SOFT))
+			log_error("Could not soft reset GNSS Receiver");
+		else
+			log_info("GNSS SOFT RESET performed");
+		/* Fixed position was only kept in RAM, configuration is reloaded */
+		gnss_restore_fixed_position(gnss);
+	} else if (action == GNSS_ACTION_HARD) {
+		log_debug("Performing GNSS HARD RESET");
+		if (!rxReset(gnss->rx, RX_RESET_HARD))
+			log_error("Could not hard reset GNSS Receiver");
+		else
+			log_info("GNSS HARD RESET performed");
+		/* Fixed position was only kept in RAM */
+		gnss_restore_fixed_position(gnss);
+	} else if (action == GNSS_ACTION_COLD) {
+		log_debug("Performing GNSS COLD RESET");
+		if (!rxReset(gnss->rx, RX_RESET_COLD))
+			log_error("Could not cold reset GNSS Receiver");
+		else
+			log_info("GNSS COLD RESET performed");
+	} else if (action == GNSS_ACTION_RESET_SERIAL)
+	{
+		gnss_reset_serial(gnss);
+	}
+}
+
 /**
  * @brief Thread routine
  *
+ * Thread sleeps in epoll_wait until bytes are received from the receiver
+ * or an action or stop is notified through the eventfd. Receiver's tty is
+ * watched through a dedicated read only file descriptor that is never read:
+ * bytes are consumed by ubloxcfg, which returns messages as soon as they
+ * are complete.
+ * UART timeout is detected when no message is received for GNSS_TIMEOUT_MS.
+ *
  * @param p_data
  * @return void*
  */
 static void * gnss_thread(void * p_data)
 {
 	EPOCH_t coll;
-	EPOCH_t epoch;
 	struct gnss *gnss = (struct gnss*) p_data;
-	struct gps_device_t * session;
 	enum gnss_action action = GNSS_ACTION_NONE;
+	struct epoll_event event;
+	struct timespec last_msg;
 	bool stop;
 
 	epochInit(&coll);
 
+	gnss->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (gnss->epoll_fd < 0) {
+		log_error("GNSS: epoll_create1: %s", strerror(errno));
+		return NULL;
+	}
+	event.events = EPOLLIN;
+	event.data.fd = gnss->event_fd;
+	if (epoll_ctl(gnss->epoll_fd, EPOLL_CTL_ADD, gnss->event_fd, &event) < 0)
+		log_error("GNSS: Could not watch event fd: %s", strerror(errno));
+	gnss_watch_tty(gnss);
+
 	pthread_mutex_lock(&gnss->mutex_data);
 	stop = gnss->stop;
 	pthread_mutex_unlock(&gnss->mutex_data);
 
+	clock_gettime(CLOCK_MONOTONIC, &last_msg);
 	while (!stop)
 	{
-		PARSER_MSG_t *msg = rxGetNextMessageTimeout(gnss->rx, GNSS_TIMEOUT_MS);
-		if (msg != NULL)
-		{
-			pthread_mutex_lock(&gnss->mutex_data);
-			session = gnss->session;
-			// Epoch collect is used to fetch navigation data such as time and leap seconds
-			if(epochCollect(&coll, msg, &epoch))
-			{
-				// if epoch has no fix there will be no Nav solution and 0 satellites
-				session->satellites_count = gnss_get_satellites(&epoch);
-				if (epoch.haveFix) {
-					session->last_fix_utc_time.tv_sec = gnss_get_utc_time(&epoch);
-					session->fix = epoch.fix;
-					session->fixOk = epoch.fixOk && session->satellites_count > NUM_SAT_MIN;
-					session->valid = session->fix >= EPOCH_FIX_TIME && session->fixOk;
-					if (!session->valid) {
-						if (session->fix < EPOCH_FIX_TIME)
-							log_trace("Fix is to low: %d", session->fix);
-						if (!session->fixOk)
-							log_trace("Fix is not OK");
-					}
-					struct timedelta_t td;
-					ntp_latch(session, &td);
-					log_gnss_data(session);
-				} else {
-					session->fix = NO_FIX;
-					session->fixOk = false;
-				}
-				pthread_cond_signal(&gnss->cond_data);
-
-				if (session->tai_time_set)
-					pthread_cond_signal(&gnss->cond_time);
-				else
-					log_warn("Could not tai time from gnss, please check GNSS Configuration if this message keeps appearing more than 25 minutes");
+		PARSER_MSG_t *msg;
+		int64_t timeout;
+		int nready;
+
+		/* Process all messages already received */
+		while ((msg = rxGetNextMessage(gnss->rx)) != NULL) {
+			gnss_process_message_timed(gnss, &coll, msg);
+			clock_gettime(CLOCK_MONOTONIC, &last_msg);
+		}
 
-			} else {
-				// Analyze msg to parse UBX-MON-RF to get antenna status
-				uint8_t clsId = UBX_CLSID(msg->data);
-				uint8_t msgId = UBX_MSGID(msg->data);
-				if (clsId == UBX_MON_CLSID && msgId == UBX_MON_RF_MSGID) {
-					gnss_get_antenna_data(session, msg);
-					log_trace("GNSS: Antenna status: 0x%x", session->antenna_status);
-					log_trace("GNSS: Power status: 0x%x", session->antenna_power);
-					if (session->antenna_power == UBX_MON_RF_V0_ANTPOWER_OFF) {
-						/* Antenna power is off, hence this is the only message we will get on the serial
-						 * We need to signal main thread that we do not have fix nor satellite count
-						 * Reset data because we cannot assume either of these
-						 */
-						gnss_reset_session_navigation_data(gnss->session);
-						pthread_cond_signal(&gnss->cond_data);
-					}
-				// Parse UBX-NAV-TIMELS messages there because library does not do it
-				} else if (clsId == UBX_NAV_CLSID && msgId == UBX_NAV_TIMELS_MSGID)
-					gnss_parse_ubx_nav_timels(session, msg);
-				else if (clsId == UBX_TIM_CLSID && msgId == UBX_TIM_TP_MSGID)
-					gnss_parse_ubx_tim_tp(session, msg);
-				else if (clsId == UBX_TIM_CLSID && msgId == UBX_TIM_SVIN_MSGID) {
-					enum SurveyInState surveyInState = gnss_parse_ubx_tim_svin(session, msg);
-					if (!session->survey_completed && !gnss->session->bypass_survey) {
-						switch (surveyInState) {
-						case SURVEY_IN_COMPLETED:
-							session->survey_completed = true;
-							break;
-						case SURVEY_IN_IN_PROGRESS:
-						case SURVEY_IN_UNKNOWN:
-							break;
-						case SURVEY_IN_KO:
-						default:
-							log_error("Survey In did not complete in time. GNSS conditions are not stable enough for optimal timing performance");
-							log_error("Please check your antenna setup (antenna on roof is way more precise) to pass survey in.");
-							break;
-						}
-					}
-				}
-			}
-			pthread_mutex_unlock(&gnss->mutex_data);
-		} else {
+		timeout = GNSS_TIMEOUT_MS - gnss_elapsed_ms(&last_msg);
+		if (timeout <= 0) {
 			log_warn("UART GNSS Timeout !");
-			pthread_mutex_lock(&gnss->mutex_data);
 			/* Reset data because we cannot assume either of these */
 			gnss_reset_session_navigation_data(gnss->session);
-			reset_serial(gnss->rx);
-			pthread_cond_signal(&gnss->cond_data);
-			pthread_mutex_unlock(&gnss->mutex_data);
-			usleep(5 * 1000);
+			gnss_reset_serial(gnss);
+			gnss_publish_epoch(gnss);
+			clock_gettime(CLOCK_MONOTONIC, &last_msg);
+			timeout = GNSS_TIMEOUT_MS;
 		}
-
-		/* this thread is the only writer to gnss->session, it's safe read the same values without mutex_data locked */
-		if (gnss->gnss_info) {
-			struct gnss_state *gnss_info = gnss->gnss_info;
-			pthread_mutex_lock(&gnss_info->lock);
-			gnss_info->antenna_power = gnss->session->antenna_power;
-			gnss_info->antenna_status = gnss->session->antenna_status;
-			gnss_info->fix = gnss->session->fix;
-			gnss_info->fixOk = gnss->session->fixOk;
-			gnss_info->leap_seconds = gnss->session->context->leap_seconds;
-			gnss_info->lsChange = gnss->session->context->lsChange;
-			gnss_info->satellites_count = gnss->session->satellites_count;
-			gnss_info->survey_in_position_error = gnss->session->survey_in_position_error;
-			pthread_mutex_unlock(&gnss_info->lock);
+		/* Without tty readiness, poll receiver periodically */
+		if (gnss->tty_fd < 0 && timeout > GNSS_POLL_MS)
+			timeout = GNSS_POLL_MS;
+
+		nready = epoll_wait(gnss->epoll_fd, &event, 1, timeout);
+		if (nready < 0 && errno != EINTR)
+			log_error("GNSS: epoll_wait: %s", strerror(errno));
+		if (nready > 0 && event.data.fd == gnss->event_fd) {
+			uint64_t count;
+			if (read(gnss->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+				log_error("GNSS: Could not read event fd: %s", strerror(errno));
 		}
 
+		gnss_update_monitoring(gnss);
+
 		pthread_mutex_lock(&gnss->mutex_data);
 		stop = gnss->stop;
 		action = gnss->action;
 		gnss->action = GNSS_ACTION_NONE;
 		pthread_mutex_unlock(&gnss->mutex_data);
 
-		if (action == GNSS_ACTION_START) {
-			log_debug("Performing GNSS START");
-			if (!rxReset(gnss->rx, RX_RESET_GNSS_START))
-				log_error("Could not start GNSS Receiver");
-			else
-				log_info("GNSS START performed");
-		} else if (action == GNSS_ACTION_STOP) {
-			log_debug("Performing GNSS STOP");
-			if (!rxReset(gnss->rx, RX_RESET_GNSS_STOP))
-				log_error("Could not stop GNSS Receiver");
-			else
-				log_info("GNSS STOP performed");
-		} else if (action == GNSS_ACTION_SOFT) {
-			log_debug("Performing GNSS SOFT RESET");
-			if (!rxReset(gnss->rx, RX_RESET_SOFT))
-				log_error("Could not soft reset GNSS Receiver");
-			else
-				log_info("GNSS SOFT RESET performed");
-		} else if (action == GNSS_ACTION_HARD) {
-			log_debug("Performing GNSS HARD RESET");
-			if (!rxReset(gnss->rx, RX_RESET_HARD))
-				log_error("Could not hard reset GNSS Receiver");
-			else
-				log_info("GNSS HARD RESET performed");
-		} else if (action == GNSS_ACTION_COLD) {
-			log_debug("Performing GNSS COLD RESET");
-			if (!rxReset(gnss->rx, RX_RESET_COLD))
-				log_error("Could not cold reset GNSS Receiver");
-			else
-				log_info("GNSS COLD RESET performed");
-		} else if (action == GNSS_ACTION_RESET_SERIAL)
-		{
-			reset_serial(gnss->rx);
+		if (action != GNSS_ACTION_NONE) {
+			gnss_handle_action(gnss, action);
+			/* Receiver may not send anything while handling action */
+			clock_gettime(CLOCK_MONOTONIC, &last_msg);
 		}
 	}
 
-	log_debug("Closing gnss session");
-	rxClose(gnss->rx);
-	free(gnss->rx);
-	gnss->rx = NULL;
-	free(gnss);
-	gnss = NULL;
+	/* Receiver is closed and freed by gnss_stop once thread is joined */
+	gnss_unwatch_tty(gnss);
+	close(gnss->epoll_fd);
+	gnss->epoll_fd = -1;
 	return NULL;
 }
 
 /**
- * @brief Stop gnss thread
+ * @brief Wake up gnss thread so that it handles stop or action right away
+ *
+ * @param gnss
+ */
+static void gnss_notify(struct gnss *gnss)
+{
+	uint64_t one = 1;
+
+	if (write(gnss->event_fd, &one, sizeof(one)) < 0)
+		log_error("GNSS: Could not notify thread: %s", strerror(errno));
+}
+
+/**
+ * @brief Stop gnss thread, then close receiver and free gnss
  *
  * @param gnss
  */
@@ -1022,10 +2113,59 @@ void gnss_stop(struct gnss *gnss)
 
 	pthread_mutex_lock(&gnss->mutex_data);
 	gnss->stop = true;
+	/* Wake up threads waiting for an epoch */
+	pthread_cond_broadcast(&gnss->cond_data);
 	pthread_mutex_unlock(&gnss->mutex_data);
+	gnss_notify(gnss);
 
 	pthread_join(gnss->thread, NULL);
-	return;
+
+	log_debug("Closing gnss session");
+	close(gnss->event_fd);
+	rxClose(gnss->rx);
+	free(gnss->rx);
+	gnss->rx = NULL;
+	gnss_capture_close(&gnss->capture);
+	free(gnss);
+}
+
+/**
+ * @brief Set monitoring data updated by gnss thread
+ *
+ * @param gnss
+ * @param gnss_info monitoring data, NULL to stop updating it
+ */
+void gnss_set_monitoring(struct gnss *gnss, struct gnss_state *gnss_info)
+{
+	if (!gnss)
+		return;
+	__atomic_store_n(&gnss->gnss_info, gnss_info, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Tell receiver whether the clock is disciplined on it
+ *
+ * @param gnss
+ * @param active
+ */
+void gnss_set_active(struct gnss *gnss, bool active)
+{
+	if (!gnss)
+		return;
+	__atomic_store_n(&gnss->active, active, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Set session the receiver feeds with its fixes while it is active
+ *
+ * @param gnss
+ * @param ntp_session session of the card, running the PPS thread
+ */
+void gnss_set_ntp_session(struct gnss *gnss, struct gps_device_t *ntp_session)
+{
+	if (!gnss || !ntp_session)
+		return;
+	__atomic_store_n(&gnss->ntp_session, ntp_session, __ATOMIC_RELEASE);
 }
 
 void gnss_set_action(struct gnss *gnss, enum gnss_action action)
@@ -1033,7 +2173,9 @@ void gnss_set_action(struct gnss *gnss, enum gnss_action action)
 	if (!gnss)
 		return;
 
-	if (action != GNSS_ACTION_START && action != GNSS_ACTION_STOP && action != GNSS_ACTION_SOFT && action != GNSS_ACTION_HARD && action != GNSS_ACTION_COLD) {
+	if (action != GNSS_ACTION_START && action != GNSS_ACTION_STOP &&
+		action != GNSS_ACTION_SOFT && action != GNSS_ACTION_HARD &&
+		action != GNSS_ACTION_COLD && action != GNSS_ACTION_RESET_SERIAL) {
 		log_error("Unknown action %d", action);
 		return;
 	}
@@ -1041,5 +2183,6 @@ void gnss_set_action(struct gnss *gnss, enum gnss_action action)
 	pthread_mutex_lock(&gnss->mutex_data);
 	gnss->action = action;
 	pthread_mutex_unlock(&gnss->mutex_data);
+	gnss_notify(gnss);
 	return;
 }
@@ -16,10 +16,12 @@
 #define OSCILLATORD_GNSS_H
 
 #include <ubloxcfg/ff_rx.h>
+#include <limits.h>
 #include <pthread.h>
 #include <termios.h>
 
 #include "config.h"
+#include "gnss_capture.h"
 #include "ntpshm/ppsthread.h"
 
 #define MAX_DEVICES 4
@@ -31,6 +33,7 @@
 
 typedef struct timespec timespec_t;	/* Unix time as sec, nsec */
 struct gps_device_t;
+struct ntpshm_publisher;
 
 /*
  * Each input source has an associated type.  This is currently used in two
@@ -126,6 +129,103 @@ struct gps_context_t {
 };
 
 
+/** Maximum number of message types counted */
+#define GNSS_MSG_STATS_MAX 64
+/** Key of messages that are not UBX ones */
+#define GNSS_MSG_KEY_OTHER(type) (0xff00 | (type))
+
+/**
+ * @struct gnss_msg_stats
+ * @brief Counters of one type of message received from the receiver
+ */
+struct gnss_msg_stats {
+	/** (class << 8 | id) for UBX messages, 0 for unused entries */
+	uint16_t key;
+	char name[24];
+	uint64_t count;
+	uint64_t bytes;
+	/** Total and maximum processing time in nanoseconds */
+	uint64_t parse_ns;
+	uint32_t max_parse_ns;
+	/** Monotonic time of first and last message */
+	struct timespec first;
+	struct timespec last;
+};
+
+enum AntennaStatus {
+	ANT_STATUS_INIT,
+	ANT_STATUS_DONT_KNOW,
+	ANT_STATUS_OK,
+	ANT_STATUS_SHORT,
+	ANT_STATUS_OPEN,
+	ANT_STATUS_UNDEFINED
+};
+
+/** Number of quantization errors kept, indexed by TAI second modulo */
+#define GNSS_QERR_RING_SIZE 16
+
+/**
+ * @struct gnss_qerr
+ * @brief Quantization error of the pulse emitted at a TAI second
+ */
+struct gnss_qerr {
+	/** TAI second of the pulse, 0 for unused entries */
+	int64_t tai_second;
+	/** Quantization error in picoseconds */
+	int32_t qErr;
+};
+
+/** Number of GNSS ids of UBX-NAV-SAT and UBX-NAV-SIG (GPS to NavIC) */
+#define GNSS_SKY_GNSS_MAX 8
+/** Number of signal ids per GNSS in UBX-NAV-SIG */
+#define GNSS_SKY_SIG_MAX 8
+/** C/N0 histogram bins, 10 dBHz wide, last one gathers >= 50 dBHz */
+#define GNSS_SKY_CNO_BINS 6
+/** Elevation histogram bins: < 0 or unknown, 0-15, 15-30, 30-60, 60-90 degrees */
+#define GNSS_SKY_ELEV_BINS 5
+
+/**
+ * @struct gnss_sky_sat
+ * @brief Satellites of a GNSS from last UBX-NAV-SAT
+ */
+struct gnss_sky_sat {
+	uint8_t tracked;
+	uint8_t used;
+	uint16_t cno_sum;
+	uint8_t cno[GNSS_SKY_CNO_BINS];
+	uint8_t elev[GNSS_SKY_ELEV_BINS];
+	uint8_t used_elev[GNSS_SKY_ELEV_BINS];
+};
+
+/**
+ * @struct gnss_sky_sig
+ * @brief Signals of a GNSS and signal id from last UBX-NAV-SIG
+ */
+struct gnss_sky_sig {
+	uint8_t tracked;
+	uint8_t used;
+	uint16_t cno_sum;
+	uint8_t cno[GNSS_SKY_CNO_BINS];
+};
+
+/**
+ * @struct gnss_sky
+ * @brief Per constellation and per signal view of the sky
+ *
+ * Tables are rebuilt in place from each UBX-NAV-SAT and UBX-NAV-SIG, with
+ * no allocation, and published once per second with message counters.
+ */
+struct gnss_sky {
+	/** Number of UBX-NAV-SAT and UBX-NAV-SIG parsed */
+	uint32_t sat_updates;
+	uint32_t sig_updates;
+	/** GPS time of week in ms of last messages */
+	uint32_t sat_itow;
+	uint32_t sig_itow;
+	struct gnss_sky_sat sats[GNSS_SKY_GNSS_MAX];
+	struct gnss_sky_sig sigs[GNSS_SKY_GNSS_MAX][GNSS_SKY_SIG_MAX];
+};
+
 /**
  * @struct gnss_state
  * @brief Structure containing data with the latest gnss values
@@ -139,6 +239,13 @@ struct gnss_state {
 	int8_t antenna_power;
 	int8_t antenna_status;
 	bool fixOk;
+	/** Index of receiver in use and number of receivers */
+	int receiver;
+	int receivers_count;
+	/** Counters of messages received, updated once per second */
+	struct gnss_msg_stats msg_stats[GNSS_MSG_STATS_MAX];
+	/** Satellites and signals tracked, updated once per second */
+	struct gnss_sky sky;
 	pthread_mutex_t lock;
 };
 
@@ -152,6 +259,12 @@ struct gps_device_t {
 	sourcetype_t sourcetype;
 	volatile struct shmTime *shm_clock;
 	volatile struct shmTime *shm_pps;
+	/** Path of chrony SOCK refclock socket, NULL if not used */
+	const char *chrony_path;
+	/** Socket connected to chrony SOCK refclock, -1 if not connected */
+	int chronyfd;
+	/** Publisher of the sources in their NTP SHM units, NULL if not used */
+	struct ntpshm_publisher *ntpshm_publisher;
 	/** pointer to thread catching PPS event to fill the NTP SHM*/
 	volatile struct pps_thread_t pps_thread;
 	/** count of fixes from this device */
@@ -170,6 +283,8 @@ struct gps_device_t {
 	bool tai_time_set;
 	/** TAI time */
 	int tai_time;
+	/** Quantization errors of last pulses, from UBX-TIM-TP */
+	struct gnss_qerr qerr[GNSS_QERR_RING_SIZE];
 	/** Number of satellites used */
 	int satellites_count;
 	/** Wether Survey In should be bypassed or not */
@@ -178,32 +293,120 @@ struct gps_device_t {
 	bool survey_completed;
 	/** Survey in error in meter from meanV field from UBX-TIM-SVIN msg */
 	float survey_in_position_error;
+	/** Mean position of last UBX-TIM-SVIN, ECEF in cm */
+	int32_t survey_ecef[3];
+	/** Variance of survey in mean position in mm^2 */
+	uint32_t survey_mean_v;
+};
+
+/**
+ * @struct gnss_epoch
+ * @brief Immutable record of GNSS data published once per navigation epoch
+ */
+struct gnss_epoch {
+	/** Epoch number, incremented at each publication, first one is 1 */
+	uint64_t number;
+	/** General indicator that GNSS data are valid (Fix >= time + fixOk) */
+	bool valid;
+	int fix;
+	bool fixOk;
+	int satellites_count;
+	/** UTC time of last fix */
+	struct timespec last_fix_utc_time;
+	/** TAI time of last pulse, only meaningful if tai_time_set */
+	bool tai_time_set;
+	int tai_time;
+	/** Quantization errors of current and last epoch */
+	int32_t qErr;
+	int32_t qErr_last_epoch;
+	/** Quantization errors of last pulses, keyed by TAI second */
+	struct gnss_qerr qerr[GNSS_QERR_RING_SIZE];
+	bool survey_completed;
+	float survey_in_position_error;
+	bool lsset;
+	int leap_seconds;
+	int lsChange;
+	int leap_notify;
+	int8_t antenna_status;
+	int8_t antenna_power;
 };
 
 /**
  * @struct gnss
  * @brief General thread structure
+ *
+ * Thread parses messages into session, which is private to it, and publishes
+ * a struct gnss_epoch at each navigation epoch. Epoch record is protected by
+ * epoch_seq sequence counter so readers never wait for message parsing,
+ * cond_data is only used to notify waiters that a new epoch is available.
  */
 struct gnss {
+	/** Index of the receiver, 0 for the receiver of the card */
+	unsigned int index;
 	bool session_open;
 	RX_t *rx;
 	struct gps_device_t *session;
 	pthread_t thread;
+	/** Protects stop and action, and is used with cond_data */
 	pthread_mutex_t mutex_data;
-	pthread_cond_t cond_time;
 	pthread_cond_t cond_data;
+	/** Sequence counter of epoch, odd while epoch is being written */
+	uint32_t epoch_seq;
+	/** Number of last epoch published */
+	uint64_t epoch_number;
+	struct gnss_epoch epoch;
 	int fd_clock;
+	/** Device receiver is opened on, optionally followed by @baudrate */
+	char tty[PATH_MAX];
+	/**
+	 * Read only fd on receiver's tty, only used to watch for incoming bytes,
+	 * closed while ubloxcfg's port is closed. Only accessed by gnss thread
+	 */
+	int tty_fd;
+	/** epoll instance of gnss thread */
+	int epoll_fd;
+	/** eventfd used to wake up thread on action or stop */
+	int event_fd;
 	enum gnss_action action;
 	bool stop;
 	int receiver_version_major;
 	int receiver_version_minor;
+	/** Baudrate of receiver's UART1 */
+	unsigned int baudrate;
+	/** Capture of data received, NULL if disabled */
+	struct gnss_capture *capture;
+	/** File where surveyed position is kept, empty if disabled */
+	char survey_state_file[PATH_MAX];
+	/** Fingerprint of antenna configuration the position is surveyed with */
+	uint64_t antenna_fingerprint;
+	/** Receiver uses the position of a previous survey */
+	bool fixed_position;
 	struct gnss_state *gnss_info;
+	/** Receiver is the one the clock is disciplined on, set by GNSS selector */
+	bool active;
+	/**
+	 * Session of the card, whose PPS thread and NTP publisher are fed with
+	 * fixes of the active receiver
+	 */
+	struct gps_device_t *ntp_session;
+	/** Counters of messages received, only accessed by gnss thread */
+	struct gnss_msg_stats msg_stats[GNSS_MSG_STATS_MAX];
+	struct timespec msg_stats_published;
+	/** Satellites and signals tracked, only accessed by gnss thread */
+	struct gnss_sky sky;
 };
 
-struct gnss* gnss_init(const struct config *config, char *gnss_device_tty, struct gps_device_t *session, int fd_clock);
+struct gnss* gnss_init(const struct config *config, char *gnss_device_tty, struct gps_device_t *session,
+	int fd_clock, unsigned int index);
+int gnss_get_epoch(struct gnss *gnss, uint64_t after, struct gnss_epoch *epoch);
+void gnss_get_last_epoch(struct gnss *gnss, struct gnss_epoch *epoch);
 int gnss_get_epoch_data(struct gnss *gnss, bool *valid, bool *survey, int32_t *qErr);
+int gnss_get_qerr(struct gnss *gnss, int64_t tai_second, int32_t *qErr);
 void gnss_stop(struct gnss *gnss);
 void gnss_set_action(struct gnss *gnss, enum gnss_action action);
+void gnss_set_monitoring(struct gnss *gnss, struct gnss_state *gnss_info);
+void gnss_set_active(struct gnss *gnss, bool active);
+void gnss_set_ntp_session(struct gnss *gnss, struct gps_device_t *ntp_session);
 int gnss_set_ptp_clock_time(struct gnss *gnss);
 int gnss_get_fix_info(struct gnss *gnss, bool *valid, struct timespec *fixUtc);
 
@@ -0,0 +1,100 @@
+/**
+ * @file gnss_capture.c
+ * @brief Capture of raw data received from the GNSS receiver
+ * @date 2023-10-09
+ *
+ * @copyright Copyright (c) 2023
+ */
+#include <endian.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gnss_capture.h"
+#include "log.h"
+
+/**
+ * @brief Create capture file
+ *
+ * @param path path of the file, truncated if it exists
+ * @return struct gnss_capture* on success, NULL on error
+ */
+struct gnss_capture *gnss_capture_open(const char *path)
+{
+	struct gnss_capture_header header = {
+		.magic = GNSS_CAPTURE_MAGIC,
+		.version = htole32(GNSS_CAPTURE_VERSION),
+	};
+	struct gnss_capture *capture;
+
+	capture = calloc(1, sizeof(*capture));
+	if (capture == NULL) {
+		log_error("GNSS capture: Could not allocate memory");
+		return NULL;
+	}
+
+	capture->file = fopen(path, "we");
+	if (capture->file == NULL) {
+		log_error("GNSS capture: Could not open %s: %s", path, strerror(errno));
+		free(capture);
+		return NULL;
+	}
+
+	if (fwrite(&header, sizeof(header), 1, capture->file) != 1) {
+		log_error("GNSS capture: Could not write %s: %s", path, strerror(errno));
+		fclose(capture->file);
+		free(capture);
+		return NULL;
+	}
+	log_info("GNSS capture: capturing receiver data in %s", path);
+
+	return capture;
+}
+
+/**
+ * @brief Append data received to the capture
+ *
+ * File is flushed at most once per second.
+ *
+ * @param capture capture, may be NULL
+ * @param data data received
+ * @param length number of bytes received
+ */
+void gnss_capture_write(struct gnss_capture *capture, const uint8_t *data, uint32_t length)
+{
+	struct gnss_capture_record record;
+	struct timespec ts;
+	uint64_t timestamp;
+
+	if (capture == NULL || capture->file == NULL || length == 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	timestamp = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	record.timestamp = htole64(timestamp);
+	record.length = htole32(length);
+
+	if (fwrite(&record, sizeof(record), 1, capture->file) != 1 ||
+		fwrite(data, length, 1, capture->file) != 1) {
+		log_error("GNSS capture: write failed, stopping capture: %s", strerror(errno));
+		fclose(capture->file);
+		capture->file = NULL;
+		return;
+	}
+
+	if ((uint64_t) ts.tv_sec != capture->flushed) {
+		fflush(capture->file);
+		capture->flushed = ts.tv_sec;
+	}
+}
+
+void gnss_capture_close(struct gnss_capture **capture)
+{
+	if (capture == NULL || *capture == NULL)
+		return;
+	if ((*capture)->file != NULL)
+		fclose((*capture)->file);
+	free(*capture);
+	*capture = NULL;
+}
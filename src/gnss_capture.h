@@ -0,0 +1,48 @@
+/**
+ * @file gnss_capture.h
+ * @brief Capture of raw data received from the GNSS receiver
+ * @date 2023-10-09
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Every message received from the receiver (UBX, NMEA, RTCM3 or bytes the
+ * parser could not decode) is appended to the capture file as a record, so
+ * that a session can be replayed later with tests/ubx_replay.
+ * File starts with a header, records follow in reception order. All fields
+ * are little endian.
+ */
+#ifndef GNSS_CAPTURE_H
+#define GNSS_CAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define GNSS_CAPTURE_MAGIC "ODUBXCAP"
+#define GNSS_CAPTURE_VERSION 1
+/* Larger than the biggest message ubloxcfg's parser can return */
+#define GNSS_CAPTURE_MAX_RECORD_SIZE 0x10000
+
+struct gnss_capture_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+} __attribute__((packed));
+
+struct gnss_capture_record {
+	/** CLOCK_MONOTONIC time of reception in nanoseconds */
+	uint64_t timestamp;
+	/** Number of bytes following the record */
+	uint32_t length;
+} __attribute__((packed));
+
+struct gnss_capture {
+	FILE *file;
+	/** Second of last flush of the file */
+	uint64_t flushed;
+};
+
+struct gnss_capture *gnss_capture_open(const char *path);
+void gnss_capture_write(struct gnss_capture *capture, const uint8_t *data, uint32_t length);
+void gnss_capture_close(struct gnss_capture **capture);
+
+#endif /* GNSS_CAPTURE_H */
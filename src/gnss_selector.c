@@ -0,0 +1,340 @@
+/**
+ * @file gnss_selector.c
+ * @brief Selection of the GNSS receiver used among several ones
+ * @date 2023-10-10
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * A receiver is healthy when it keeps publishing epochs and UBX-TIM-TP, has
+ * a valid time fix and no antenna fault. Its score favours the best fix and
+ * most satellites, less the recent pulses whose quantization error is missing
+ * and the magnitude of the last one. Healthy receivers are cross-checked
+ * on TAI time of their last pulse and of the next pulse described by
+ * UBX-TIM-TP: the receivers disagreeing with most of the others are
+ * inconsistent. With two receivers, the active one is trusted.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnss_selector.h"
+#include "log.h"
+
+static int64_t elapsed_ms(const struct timespec *since, const struct timespec *now)
+{
+	return (now->tv_sec - since->tv_sec) * 1000 +
+		(now->tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/**
+ * @brief Get TAI second of the most recent pulse described by UBX-TIM-TP
+ */
+static int64_t gnss_epoch_next_pulse(const struct gnss_epoch *epoch)
+{
+	int64_t next_pulse = 0;
+
+	for (int i = 0; i < GNSS_QERR_RING_SIZE; i++) {
+		if (epoch->qerr[i].tai_second > next_pulse)
+			next_pulse = epoch->qerr[i].tai_second;
+	}
+	return next_pulse;
+}
+
+/**
+ * @brief Count pulses of the last GNSS_QERR_RING_SIZE seconds without quantization error
+ */
+static int gnss_epoch_missing_qerr(const struct gnss_epoch *epoch, int64_t next_pulse)
+{
+	int missing = 0;
+
+	for (int64_t second = next_pulse - GNSS_QERR_RING_SIZE + 1; second <= next_pulse; second++) {
+		if (second > 0 && epoch->qerr[second % GNSS_QERR_RING_SIZE].tai_second != second)
+			missing++;
+	}
+	return missing;
+}
+
+static bool gnss_epochs_agree(const struct gnss_epoch *a, const struct gnss_epoch *b)
+{
+	/* Receivers may be sampled on both sides of an epoch */
+	return llabs((long long) a->tai_time - b->tai_time) <= 1 &&
+		llabs((long long) (gnss_epoch_next_pulse(a) - gnss_epoch_next_pulse(b))) <= 1;
+}
+
+/**
+ * @brief Evaluate health of a receiver from its last epoch
+ */
+static void gnss_receiver_evaluate(struct gnss_receiver *receiver, const struct gnss_epoch *epoch,
+	const struct timespec *now)
+{
+	int64_t next_pulse = gnss_epoch_next_pulse(epoch);
+	int32_t qErr = next_pulse > 0 ? epoch->qerr[next_pulse % GNSS_QERR_RING_SIZE].qErr : 0;
+	int missing = gnss_epoch_missing_qerr(epoch, next_pulse);
+	bool healthy;
+
+	if (epoch->number != receiver->last_epoch) {
+		receiver->last_epoch = epoch->number;
+		receiver->last_epoch_time = *now;
+	}
+
+	healthy = elapsed_ms(&receiver->last_epoch_time, now) <= GNSS_SELECTOR_STALE_MS &&
+		epoch->valid && epoch->tai_time_set &&
+		next_pulse > epoch->tai_time &&
+		epoch->antenna_status != ANT_STATUS_SHORT &&
+		epoch->antenna_status != ANT_STATUS_OPEN;
+	if (healthy != receiver->healthy)
+		log_info("GNSS selector: receiver %u is %s (fix %d, fixOk %d, antenna %d, %d satellites, qErr %d ps, %d missing)",
+			receiver->gnss->index, healthy ? "healthy" : "unhealthy", epoch->fix,
+			epoch->fixOk, epoch->antenna_status, epoch->satellites_count, qErr, missing);
+	receiver->healthy = healthy;
+	/* qErr in ns, so that it only breaks ties between similar receivers */
+	receiver->score = healthy ? epoch->fix * 100 + epoch->satellites_count -
+		missing * GNSS_SELECTOR_QERR_MISSING_PENALTY - abs(qErr) / 1000 : -1;
+}
+
+/**
+ * @brief Cross-check TAI time of healthy receivers
+ *
+ * Reference is the healthy receiver agreeing with most of the others, the
+ * active one on ties.
+ */
+static void gnss_selector_cross_check(struct gnss_selector *selector,
+	const struct gnss_epoch epochs[GNSS_SELECTOR_MAX])
+{
+	int reference = -1;
+	int best_agreements = -1;
+
+	for (int i = 0; i < selector->count; i++) {
+		int agreements = 0;
+
+		if (!selector->receivers[i].healthy)
+			continue;
+		for (int j = 0; j < selector->count; j++) {
+			if (j != i && selector->receivers[j].healthy &&
+				gnss_epochs_agree(&epochs[i], &epochs[j]))
+				agreements++;
+		}
+		if (agreements > best_agreements ||
+			(agreements == best_agreements && i == selector->active)) {
+			best_agreements = agreements;
+			reference = i;
+		}
+	}
+
+	for (int i = 0; i < selector->count; i++) {
+		struct gnss_receiver *receiver = &selector->receivers[i];
+		bool consistent = !receiver->healthy || reference < 0 ||
+			gnss_epochs_agree(&epochs[i], &epochs[reference]);
+
+		if (!consistent && receiver->consistent)
+			log_warn("GNSS selector: receiver %u disagrees with receiver %u (TAI %d, next pulse %lld vs TAI %d, next pulse %lld)",
+				receiver->gnss->index, selector->receivers[reference].gnss->index,
+				epochs[i].tai_time, (long long) gnss_epoch_next_pulse(&epochs[i]),
+				epochs[reference].tai_time, (long long) gnss_epoch_next_pulse(&epochs[reference]));
+		receiver->consistent = consistent;
+	}
+}
+
+/**
+ * @brief Start receiver of the card and secondary receivers of configuration
+ *
+ * Secondary receivers are read from gnss-secondary-N-tty config keys, N from
+ * 1 to GNSS_SELECTOR_MAX - 1. gnss-secondary-N-pps-extts gives the index of
+ * the PHC external timestamp their PPS is wired to, they are only used for
+ * cross-checking if it is not set.
+ *
+ * @param config configuration
+ * @param gnss_device_tty tty of the receiver of the card
+ * @param session session of the receiver of the card
+ * @param fd_clock PHC handler
+ * @return struct gnss_selector*, NULL on error
+ */
+struct gnss_selector *gnss_selector_init(const struct config *config, char *gnss_device_tty,
+	struct gps_device_t *session, int fd_clock)
+{
+	struct gnss_selector *selector;
+	struct timespec now;
+
+	selector = calloc(1, sizeof(*selector));
+	if (selector == NULL) {
+		log_error("GNSS selector: could not allocate memory");
+		return NULL;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	selector->receivers[0].gnss = gnss_init(config, gnss_device_tty, session, fd_clock, 0);
+	if (selector->receivers[0].gnss == NULL) {
+		free(selector);
+		return NULL;
+	}
+	selector->receivers[0].pps_extts = EXTTS_INDEX_GNSS_PPS;
+	selector->count = 1;
+
+	for (int i = 1; i < GNSS_SELECTOR_MAX; i++) {
+		struct gnss_receiver *receiver = &selector->receivers[selector->count];
+		char key[64];
+		char tty[PATH_MAX];
+		const char *value;
+		long pps_extts;
+
+		snprintf(key, sizeof(key), "gnss-secondary-%d-tty", i);
+		value = config_get(config, key);
+		if (value == NULL)
+			continue;
+		snprintf(tty, sizeof(tty), "%s", value);
+		snprintf(key, sizeof(key), "gnss-secondary-%d-pps-extts", i);
+		pps_extts = config_get_unsigned_number(config, key);
+
+		receiver->session = calloc(1, sizeof(*receiver->session));
+		if (receiver->session != NULL)
+			receiver->session->context = calloc(1, sizeof(*receiver->session->context));
+		if (receiver->session == NULL || receiver->session->context == NULL) {
+			log_error("GNSS selector: could not allocate memory for receiver %d", i);
+			free(receiver->session);
+			receiver->session = NULL;
+			continue;
+		}
+		receiver->session->context->leap_notify = LEAP_NOWARNING;
+
+		receiver->gnss = gnss_init(config, tty, receiver->session, fd_clock, i);
+		if (receiver->gnss == NULL) {
+			log_warn("GNSS selector: could not start secondary receiver %d on %s: %s, skipping it",
+				i, tty, strerror(errno));
+			free(receiver->session->context);
+			free(receiver->session);
+			receiver->session = NULL;
+			continue;
+		}
+		/* NTP keeps being fed by the card's PPS thread after a failover */
+		gnss_set_ntp_session(receiver->gnss, session);
+		receiver->pps_extts = pps_extts >= 0 ? pps_extts : -1;
+		log_info("GNSS selector: secondary receiver %d on %s, PPS %s%ld", i, tty,
+			pps_extts >= 0 ? "on external timestamp " : "not wired", pps_extts >= 0 ? pps_extts : 0);
+		selector->count++;
+	}
+
+	for (int i = 0; i < selector->count; i++) {
+		selector->receivers[i].last_epoch_time = now;
+		selector->receivers[i].consistent = true;
+	}
+	selector->active = 0;
+
+	return selector;
+}
+
+/**
+ * @brief Set monitoring data, updated by the active receiver
+ *
+ * @param selector
+ * @param gnss_info monitoring data
+ */
+void gnss_selector_set_monitoring(struct gnss_selector *selector, struct gnss_state *gnss_info)
+{
+	if (selector == NULL)
+		return;
+	selector->gnss_info = gnss_info;
+	pthread_mutex_lock(&gnss_info->lock);
+	gnss_info->receiver = selector->receivers[selector->active].gnss->index;
+	gnss_info->receivers_count = selector->count;
+	pthread_mutex_unlock(&gnss_info->lock);
+	gnss_set_monitoring(selector->receivers[selector->active].gnss, gnss_info);
+}
+
+struct gnss *gnss_selector_active(struct gnss_selector *selector)
+{
+	if (selector == NULL)
+		return NULL;
+	return selector->receivers[selector->active].gnss;
+}
+
+/**
+ * @brief Evaluate receivers and fail over if active one is not usable anymore
+ *
+ * Active receiver is kept as long as it is healthy and consistent. Otherwise
+ * the healthy and consistent receiver with the best score whose PPS reaches the phasemeter becomes active, and phasemeter is switched
+ * to its PPS.
+ *
+ * @param selector
+ * @param phasemeter phasemeter measuring the PPS of the active receiver, may be NULL
+ * @return active receiver
+ */
+struct gnss *gnss_selector_update(struct gnss_selector *selector, struct phasemeter *phasemeter)
+{
+	struct gnss_epoch epochs[GNSS_SELECTOR_MAX];
+	struct gnss_receiver *active;
+	struct gnss_receiver *candidate = NULL;
+	struct timespec now;
+	int best = -1;
+
+	if (selector == NULL)
+		return NULL;
+	active = &selector->receivers[selector->active];
+	if (selector->count == 1)
+		return active->gnss;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (int i = 0; i < selector->count; i++) {
+		gnss_get_last_epoch(selector->receivers[i].gnss, &epochs[i]);
+		gnss_receiver_evaluate(&selector->receivers[i], &epochs[i], &now);
+	}
+	gnss_selector_cross_check(selector, epochs);
+
+	if (active->healthy && active->consistent)
+		return active->gnss;
+
+	for (int i = 0; i < selector->count; i++) {
+		struct gnss_receiver *receiver = &selector->receivers[i];
+
+		if (i == selector->active || !receiver->healthy || !receiver->consistent)
+			continue;
+		if (phasemeter != NULL && receiver->pps_extts < 0)
+			continue;
+		if (candidate == NULL || receiver->score > candidate->score) {
+			candidate = receiver;
+			best = i;
+		}
+	}
+	if (candidate == NULL)
+		return active->gnss;
+
+	if (phasemeter != NULL && phasemeter_set_gnss_input(phasemeter, candidate->pps_extts) != 0)
+		return active->gnss;
+
+	log_warn("GNSS selector: receiver %u is %s, failing over to receiver %u",
+		active->gnss->index, active->healthy ? "inconsistent" : "unhealthy",
+		candidate->gnss->index);
+	if (selector->gnss_info != NULL) {
+		gnss_set_monitoring(active->gnss, NULL);
+		pthread_mutex_lock(&selector->gnss_info->lock);
+		selector->gnss_info->receiver = candidate->gnss->index;
+		pthread_mutex_unlock(&selector->gnss_info->lock);
+		gnss_set_monitoring(candidate->gnss, selector->gnss_info);
+	}
+	gnss_set_active(active->gnss, false);
+	gnss_set_active(candidate->gnss, true);
+	selector->active = best;
+
+	return candidate->gnss;
+}
+
+/**
+ * @brief Stop all receivers and free selector
+ *
+ * @param selector
+ */
+void gnss_selector_stop(struct gnss_selector *selector)
+{
+	if (selector == NULL)
+		return;
+
+	for (int i = 0; i < selector->count; i++) {
+		struct gnss_receiver *receiver = &selector->receivers[i];
+
+		gnss_stop(receiver->gnss);
+		if (receiver->session != NULL) {
+			free(receiver->session->context);
+			free(receiver->session);
+		}
+	}
+	free(selector);
+}
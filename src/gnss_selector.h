@@ -0,0 +1,69 @@
+/**
+ * @file gnss_selector.h
+ * @brief Selection of the GNSS receiver used among several ones
+ * @date 2023-10-10
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Receiver of the card is always present, secondary receivers are declared
+ * with gnss-secondary-N-tty config keys. Each receiver has its own gnss
+ * thread and epoch. Selector is evaluated by main loop at each iteration: it
+ * keeps the active receiver as long as it is healthy and consistent with the
+ * others, and fails over to the best receiver whose PPS reaches the
+ * phasemeter otherwise, so that switch happens before next pulse.
+ */
+#ifndef OSCILLATORD_GNSS_SELECTOR_H
+#define OSCILLATORD_GNSS_SELECTOR_H
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "config.h"
+#include "gnss.h"
+#include "phasemeter.h"
+
+/** Maximum number of receivers, including the one of the card */
+#define GNSS_SELECTOR_MAX 4
+/** Delay after which a receiver that did not publish an epoch is unhealthy */
+#define GNSS_SELECTOR_STALE_MS 1500
+/** Score lost for each recent pulse whose quantization error was not received */
+#define GNSS_SELECTOR_QERR_MISSING_PENALTY 10
+
+/**
+ * @struct gnss_receiver
+ * @brief Receiver handled by the selector
+ */
+struct gnss_receiver {
+	struct gnss *gnss;
+	/** Session allocated for secondary receivers, NULL for the one of the card */
+	struct gps_device_t *session;
+	/** Index of the PHC external timestamp its PPS is wired to, -1 if none */
+	int pps_extts;
+	/** Last epoch number seen and monotonic time it was seen at */
+	uint64_t last_epoch;
+	struct timespec last_epoch_time;
+	bool healthy;
+	bool consistent;
+	int score;
+};
+
+/**
+ * @struct gnss_selector
+ * @brief Receivers and the one currently used
+ */
+struct gnss_selector {
+	struct gnss_receiver receivers[GNSS_SELECTOR_MAX];
+	int count;
+	int active;
+	/** Monitoring data, updated by the active receiver */
+	struct gnss_state *gnss_info;
+};
+
+struct gnss_selector *gnss_selector_init(const struct config *config, char *gnss_device_tty,
+	struct gps_device_t *session, int fd_clock);
+void gnss_selector_set_monitoring(struct gnss_selector *selector, struct gnss_state *gnss_info);
+struct gnss *gnss_selector_active(struct gnss_selector *selector);
+struct gnss *gnss_selector_update(struct gnss_selector *selector, struct phasemeter *phasemeter);
+void gnss_selector_stop(struct gnss_selector *selector);
+
+#endif /* OSCILLATORD_GNSS_SELECTOR_H */
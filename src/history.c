@@ -0,0 +1,373 @@
+/**
+ * @file history.c
+ * @brief In memory history of monitoring values
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Aggregates rings are allocated once at startup and overwrite their
+ * oldest entries when full, per second samples are compressed in a sample
+ * store limited in memory and duration. Minute aggregates are rolled up from
+ * per second samples and hour aggregates are merged from minute aggregates.
+ */
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "history.h"
+#include "log.h"
+
+static const char *metric_names[HISTORY_METRIC_COUNT] = {
+	[HISTORY_PHASE_ERROR] = "phase_error",
+	[HISTORY_FINE_CTRL] = "fine_ctrl",
+	[HISTORY_COARSE_CTRL] = "coarse_ctrl",
+	[HISTORY_TEMPERATURE] = "temperature",
+	[HISTORY_PHASE_ERROR_CORRECTED] = "phase_error_corrected",
+};
+
+const char *history_metric_name(enum history_metric metric)
+{
+	if (metric >= HISTORY_METRIC_COUNT)
+		return "unknown";
+	return metric_names[metric];
+}
+
+static void stats_reset(struct history_stats *stats)
+{
+	stats->min = DBL_MAX;
+	stats->max = -DBL_MAX;
+	stats->mean = 0.0;
+	stats->m2 = 0.0;
+	stats->count = 0;
+}
+
+/**
+ * @brief Add a value to statistics using Welford's online algorithm
+ */
+static void stats_add(struct history_stats *stats, double value)
+{
+	double delta;
+
+	stats->count++;
+	if (value < stats->min)
+		stats->min = value;
+	if (value > stats->max)
+		stats->max = value;
+	delta = value - stats->mean;
+	stats->mean += delta / stats->count;
+	stats->m2 += delta * (value - stats->mean);
+}
+
+/**
+ * @brief Merge statistics of src into dst (Chan's parallel algorithm)
+ */
+static void stats_merge(struct history_stats *dst, const struct history_stats *src)
+{
+	double delta;
+	uint32_t count;
+
+	if (src->count == 0)
+		return;
+	if (dst->count == 0) {
+		*dst = *src;
+		return;
+	}
+
+	count = dst->count + src->count;
+	delta = src->mean - dst->mean;
+	dst->mean += delta * src->count / count;
+	dst->m2 += src->m2 + delta * delta * dst->count * src->count / count;
+	dst->count = count;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+double history_stats_stddev(const struct history_stats *stats)
+{
+	if (stats->count < 2)
+		return 0.0;
+	return sqrt(stats->m2 / (stats->count - 1));
+}
+
+static void point_reset(struct history_point *point, time_t timestamp)
+{
+	point->timestamp = timestamp;
+	for (int i = 0; i < HISTORY_METRIC_COUNT; i++)
+		stats_reset(&point->stats[i]);
+}
+
+static void sample_values(const struct history_sample *sample,
+	double values[HISTORY_METRIC_COUNT])
+{
+	values[HISTORY_PHASE_ERROR] = sample->phase_error;
+	values[HISTORY_FINE_CTRL] = sample->fine_ctrl;
+	values[HISTORY_COARSE_CTRL] = sample->coarse_ctrl;
+	values[HISTORY_TEMPERATURE] = sample->temperature;
+	values[HISTORY_PHASE_ERROR_CORRECTED] = sample->phase_error_corrected;
+}
+
+/* Integer and floating point values of a sample, as stored */
+#define SAMPLE_INTS 3
+#define SAMPLE_FLOATS 2
+
+static void point_from_stored(struct history_point *point, time_t timestamp,
+	const int32_t ints[SAMPLE_INTS], const double floats[SAMPLE_FLOATS])
+{
+	point_reset(point, timestamp);
+	stats_add(&point->stats[HISTORY_PHASE_ERROR], ints[0]);
+	stats_add(&point->stats[HISTORY_FINE_CTRL], ints[1]);
+	stats_add(&point->stats[HISTORY_COARSE_CTRL], ints[2]);
+	stats_add(&point->stats[HISTORY_TEMPERATURE], floats[0]);
+	stats_add(&point->stats[HISTORY_PHASE_ERROR_CORRECTED], floats[1]);
+}
+
+static int ring_init(struct history_ring *ring, int capacity)
+{
+	ring->points = calloc(capacity, sizeof(struct history_point));
+	if (ring->points == NULL)
+		return -ENOMEM;
+	ring->capacity = capacity;
+	ring->start = 0;
+	ring->count = 0;
+	return 0;
+}
+
+static void ring_push(struct history_ring *ring, const struct history_point *point)
+{
+	int index = (ring->start + ring->count) % ring->capacity;
+
+	ring->points[index] = *point;
+	if (ring->count < ring->capacity)
+		ring->count++;
+	else
+		ring->start = (ring->start + 1) % ring->capacity;
+}
+
+static const struct history_point *ring_get(const struct history_ring *ring, int i)
+{
+	return &ring->points[(ring->start + i) % ring->capacity];
+}
+
+/**
+ * @brief Find index of first point of the ring with a timestamp >= start
+ */
+static int ring_lower_bound(const struct history_ring *ring, time_t start)
+{
+	int low = 0;
+	int high = ring->count;
+
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (ring_get(ring, mid)->timestamp < start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/**
+ * @brief Create history
+ *
+ * Number of seconds of per second samples kept is read from
+ * history-duration config key, memory they can use in kilobytes from
+ * history-max-memory.
+ *
+ * @param config configuration
+ * @return struct history* on success, NULL on error
+ */
+struct history *history_new(const struct config *config)
+{
+	struct history *history;
+	long duration;
+	long max_memory;
+
+	duration = config_get_unsigned_number(config, "history-duration");
+	if (duration <= 0)
+		duration = HISTORY_DEFAULT_DURATION;
+	max_memory = config_get_unsigned_number(config, "history-max-memory");
+	if (max_memory <= 0)
+		max_memory = HISTORY_DEFAULT_MAX_MEMORY;
+
+	history = calloc(1, sizeof(struct history));
+	if (history == NULL) {
+		log_error("History: Could not allocate memory");
+		return NULL;
+	}
+
+	history->samples = sample_store_new(SAMPLE_INTS, SAMPLE_FLOATS,
+		max_memory * 1024, duration);
+	if (history->samples == NULL) {
+		log_error("History: Could not create sample store");
+		free(history);
+		return NULL;
+	}
+
+	if (ring_init(&history->minutes, HISTORY_MINUTES) != 0 ||
+		ring_init(&history->hours, HISTORY_HOURS) != 0) {
+		log_error("History: Could not allocate memory for aggregates");
+		free(history->minutes.points);
+		sample_store_destroy(&history->samples);
+		free(history);
+		return NULL;
+	}
+
+	point_reset(&history->current_minute, 0);
+	point_reset(&history->current_hour, 0);
+	pthread_mutex_init(&history->mutex, NULL);
+	log_info("History: keeping up to %ld seconds of samples in %ld kB",
+		duration, max_memory);
+
+	return history;
+}
+
+void history_destroy(struct history **history)
+{
+	struct history *h;
+
+	if (history == NULL || *history == NULL)
+		return;
+	h = *history;
+	pthread_mutex_destroy(&h->mutex);
+	sample_store_destroy(&h->samples);
+	free(h->minutes.points);
+	free(h->hours.points);
+	free(h);
+	*history = NULL;
+}
+
+/**
+ * @brief Close aggregates whose period ended before timestamp
+ */
+static void history_roll_up(struct history *history, time_t timestamp)
+{
+	time_t minute = timestamp - timestamp % 60;
+	time_t hour = timestamp - timestamp % 3600;
+
+	if (history->current_minute.timestamp != minute) {
+		if (history->current_minute.stats[0].count > 0) {
+			ring_push(&history->minutes, &history->current_minute);
+			for (int i = 0; i < HISTORY_METRIC_COUNT; i++)
+				stats_merge(&history->current_hour.stats[i],
+					&history->current_minute.stats[i]);
+		}
+		point_reset(&history->current_minute, minute);
+	}
+
+	if (history->current_hour.timestamp != hour) {
+		if (history->current_hour.stats[0].count > 0)
+			ring_push(&history->hours, &history->current_hour);
+		point_reset(&history->current_hour, hour);
+	}
+}
+
+/**
+ * @brief Record a sample
+ *
+ * Samples must be pushed in chronological order, a sample with the same
+ * timestamp than the previous one is ignored.
+ *
+ * @param history history, may be NULL
+ * @param sample sample to add
+ */
+void history_add(struct history *history, const struct history_sample *sample)
+{
+	double values[HISTORY_METRIC_COUNT];
+	int32_t ints[SAMPLE_INTS] = {
+		sample->phase_error,
+		sample->fine_ctrl,
+		sample->coarse_ctrl,
+	};
+	double floats[SAMPLE_FLOATS] = {
+		sample->temperature,
+		sample->phase_error_corrected,
+	};
+	time_t last;
+
+	if (history == NULL)
+		return;
+
+	pthread_mutex_lock(&history->mutex);
+	if (sample_store_last_timestamp(history->samples, &last) &&
+		sample->timestamp <= last) {
+		pthread_mutex_unlock(&history->mutex);
+		return;
+	}
+
+	if (sample_store_append(history->samples, sample->timestamp, ints, floats) < 0)
+		log_warn("History: could not store sample");
+
+	history_roll_up(history, sample->timestamp);
+	sample_values(sample, values);
+	for (int i = 0; i < HISTORY_METRIC_COUNT; i++)
+		stats_add(&history->current_minute.stats[i], values[i]);
+	pthread_mutex_unlock(&history->mutex);
+}
+
+/**
+ * @brief Get points of history in [start, end] at the requested resolution
+ *
+ * Aggregate of the period in progress is not returned
+ *
+ * @param history history
+ * @param start first timestamp of the range
+ * @param end last timestamp of the range
+ * @param resolution resolution of the points
+ * @param points array where points are stored
+ * @param max_points size of points array
+ * @return number of points stored, -EINVAL on invalid parameters
+ */
+int history_query(struct history *history, time_t start, time_t end,
+	enum history_resolution resolution, struct history_point *points,
+	int max_points)
+{
+	const struct history_ring *ring;
+	int n = 0;
+
+	if (history == NULL || points == NULL || max_points <= 0 || end < start)
+		return -EINVAL;
+
+	pthread_mutex_lock(&history->mutex);
+	switch (resolution) {
+	case HISTORY_RESOLUTION_SECOND:
+	{
+		struct sample_store_cursor cursor;
+		int32_t ints[SAMPLE_INTS];
+		double floats[SAMPLE_FLOATS];
+		time_t timestamp;
+
+		sample_store_seek(history->samples, &cursor, start);
+		while (n < max_points &&
+			sample_store_next(&cursor, &timestamp, ints, floats)) {
+			if (timestamp < start)
+				continue;
+			if (timestamp > end)
+				break;
+			point_from_stored(&points[n++], timestamp, ints, floats);
+		}
+		break;
+	}
+	case HISTORY_RESOLUTION_MINUTE:
+	case HISTORY_RESOLUTION_HOUR:
+		ring = resolution == HISTORY_RESOLUTION_MINUTE ?
+			&history->minutes : &history->hours;
+		for (int i = ring_lower_bound(ring, start);
+			i < ring->count && n < max_points; i++) {
+			const struct history_point *point = ring_get(ring, i);
+			if (point->timestamp > end)
+				break;
+			points[n++] = *point;
+		}
+		break;
+	default:
+		n = -EINVAL;
+		break;
+	}
+	pthread_mutex_unlock(&history->mutex);
+
+	return n;
+}
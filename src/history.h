@@ -0,0 +1,114 @@
+/**
+ * @file history.h
+ * @brief In memory history of monitoring values
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Main loop pushes one sample per second. Samples are kept compressed in a
+ * sample store bounded in memory, as well as rolled up aggregates per minute
+ * and per hour, so that monitoring clients can fetch a time range after an
+ * outage.
+ */
+#ifndef OSCILLATORD_HISTORY_H
+#define OSCILLATORD_HISTORY_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "config.h"
+#include "sample_store.h"
+
+/** Default number of seconds of per second samples kept */
+#define HISTORY_DEFAULT_DURATION (30 * 24 * 3600)
+/** Default memory budget of per second samples in kilobytes */
+#define HISTORY_DEFAULT_MAX_MEMORY 8192
+/** Number of minute aggregates kept, one week */
+#define HISTORY_MINUTES (7 * 24 * 60)
+/** Number of hour aggregates kept, ninety days */
+#define HISTORY_HOURS (90 * 24)
+
+enum history_metric {
+	HISTORY_PHASE_ERROR,
+	HISTORY_FINE_CTRL,
+	HISTORY_COARSE_CTRL,
+	HISTORY_TEMPERATURE,
+	HISTORY_PHASE_ERROR_CORRECTED,
+	HISTORY_METRIC_COUNT
+};
+
+enum history_resolution {
+	HISTORY_RESOLUTION_SECOND,
+	HISTORY_RESOLUTION_MINUTE,
+	HISTORY_RESOLUTION_HOUR,
+};
+
+/**
+ * @struct history_sample
+ * @brief Values recorded every second
+ */
+struct history_sample {
+	time_t timestamp;
+	int32_t phase_error;
+	int32_t fine_ctrl;
+	int32_t coarse_ctrl;
+	double temperature;
+	/** Phase error corrected by the quantization error of its pulse, in ns */
+	double phase_error_corrected;
+};
+
+/**
+ * @struct history_stats
+ * @brief Statistics of one metric over an aggregation period
+ */
+struct history_stats {
+	double min;
+	double max;
+	double mean;
+	/** Sum of squared differences to the mean (Welford) */
+	double m2;
+	uint32_t count;
+};
+
+/**
+ * @struct history_point
+ * @brief Aggregated values over a period starting at timestamp
+ */
+struct history_point {
+	time_t timestamp;
+	struct history_stats stats[HISTORY_METRIC_COUNT];
+};
+
+struct history_ring {
+	struct history_point *points;
+	int capacity;
+	int start;
+	int count;
+};
+
+/**
+ * @struct history
+ * @brief Rings of samples and aggregates
+ */
+struct history {
+	pthread_mutex_t mutex;
+	/** Per second samples */
+	struct sample_store *samples;
+	struct history_ring minutes;
+	struct history_ring hours;
+	/** Aggregates being computed for current minute and hour */
+	struct history_point current_minute;
+	struct history_point current_hour;
+};
+
+struct history *history_new(const struct config *config);
+void history_destroy(struct history **history);
+void history_add(struct history *history, const struct history_sample *sample);
+int history_query(struct history *history, time_t start, time_t end,
+	enum history_resolution resolution, struct history_point *points,
+	int max_points);
+double history_stats_stddev(const struct history_stats *stats);
+const char *history_metric_name(enum history_metric metric);
+
+#endif /* OSCILLATORD_HISTORY_H */
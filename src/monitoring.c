@@ -11,6 +11,7 @@
  */
 #include <assert.h>
 #include <arpa/inet.h>
+#include <endian.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <json-c/json.h>
@@ -19,10 +20,13 @@
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include "boot_timeline.h"
 #include "eeprom_config.h"
 #include "monitoring.h"
+#include "monitoring_binary.h"
 #include "log.h"
 
 /** The socket will not be polled for more than 2 seconds at a time */
@@ -31,39 +35,102 @@
 /** Maximum number of pending connections queued up. */
 #define N_BACKLOG 64
 
+/** Default maximum number of peers connected at the same time */
+#define DEFAULT_MAX_CLIENTS 16
+
+/** Default number of seconds after which an inactive peer is disconnected */
+#define DEFAULT_IDLE_TIMEOUT_S 300
+
+/** Maximum number of history points sent in one response */
+#define HISTORY_MAX_POINTS 500
+
 /**
- * Maximum file descriptor the socket can handle.
- *
- * One peer state will be allocated on the stack for each file descriptor (FD).
- * This number isn't exactily the maximum number of peers this program
- * will be able to handle, but this number minus 1 will be the highest
- * FD handled.
-*/
-#define MAXFDS 16 * 1024
+ * Maximum size of the serialized history points of one response, so that a
+ * page of aggregated points fits in the output queue with the rest of the
+ * response
+ */
+#define HISTORY_MAX_SIZE (128 * 1024)
 
-/** Number of chars allocated on the stack for each peer */
+/** Default duration of the range returned by history requests */
+#define HISTORY_DEFAULT_RANGE 3600
+
+/** Number of peer states allocated at once when the pool runs dry */
+#define PEER_SLAB_SIZE 8
+
+/** Number of chars allocated for each peer's receive buffer */
 #define SENDBUF_SIZE 1024
 
-typedef enum { INITIAL_ACK, WAIT_FOR_MSG, IN_MSG } ProcessingState;
+/**
+ * Requests from a peer are not read anymore while more than this number of
+ * bytes are waiting to be sent to it
+ */
+#define OUTPUT_QUEUE_HIGH_WATERMARK (64 * 1024)
+
+/** Peer is disconnected if more than this number of bytes are queued for it */
+#define OUTPUT_QUEUE_MAX_SIZE (256 * 1024)
+
+/** Maximum number of chunks sent in one sendmsg call */
+#define OUTPUT_QUEUE_MAX_IOV 16
+
+typedef enum { INITIAL_ACK, WAIT_FOR_MSG, IN_MSG, IN_BIN_MSG } ProcessingState;
+
+/** Wire format used by a peer, chosen by its first request */
+enum peer_protocol {
+	PROTOCOL_UNKNOWN,
+	PROTOCOL_JSON,
+	PROTOCOL_BINARY,
+};
+
+/** Chunk of data waiting to be sent to a peer */
+struct output_chunk {
+	struct output_chunk *next;
+	/** Number of bytes of data */
+	size_t len;
+	/** Number of bytes already sent */
+	size_t offset;
+	char data[];
+};
 
 /** Data stored for each peer. */
-typedef struct {
+typedef struct peer_state {
 	ProcessingState state;
+	enum peer_protocol protocol;
+	int fd;
 	char recv_buf[SENDBUF_SIZE];
 	int buf_end;
-	int buf_ptr;
+	/** Output queue, chunks are sent in order from head to tail */
+	struct output_chunk *out_head;
+	struct output_chunk *out_tail;
+	/** Number of bytes queued and not yet sent */
+	size_t out_pending;
+	/** Monotonic time of the last request received from the peer */
+	struct timespec last_activity;
+	bool in_use;
+	/** Next free peer state when in the pool's free list */
+	struct peer_state *next_free;
 } peer_state_t;
 
+/** Block of peer states allocated at once by the pool */
+struct peer_slab {
+	struct peer_slab *next;
+	peer_state_t peers[PEER_SLAB_SIZE];
+};
+
 /**
- * Global table of peers, with file descriptors as keys and peers as values.
+ * Pool of peer states.
  *
- * Each peer is globally identified by the file descriptor (fd) it's connected
- * on. As long as the peer is connected, the fd is unique to it. When a peer
- * disconnects, a new peer may connect and get the same fd. on_peer_connected
- * should initialize the state properly to remove any trace of the old peer on
- * the same fd.
-*/
-peer_state_t global_state[MAXFDS];
+ * Peer states are allocated by slabs of PEER_SLAB_SIZE entries, only when all
+ * previously allocated ones are in use, and are recycled through a free list
+ * when peers disconnect. The state of a peer is attached to its epoll event
+ * through epoll_event.data.ptr, the listening socket using a NULL pointer.
+ */
+struct peer_pool {
+	struct peer_slab *slabs;
+	peer_state_t *free_list;
+	int allocated;
+	int in_use;
+	int max_clients;
+};
 
 /**
  * File descriptor status.
@@ -173,101 +240,298 @@ static void report_peer_connected(const struct sockaddr_in* sa, socklen_t salen)
 }
 
 /**
- * @brief Initialize receive buffer once peer is connected
+ * @brief Get monotonic time in seconds
  *
- * @param sockfd socket file descriptor
- * @param peer_addr
- * @param peer_addr_len
- * @return fd_status_t
+ * @param ts pointer where time will be stored
  */
-static fd_status_t on_peer_connected(int sockfd, const struct sockaddr_in* peer_addr,
-									socklen_t peer_addr_len) {
-	assert(sockfd < MAXFDS);
+static void get_monotonic_time(struct timespec *ts)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
 
-	// Initialize state to send back a '*' to the peer immediately.
-	peer_state_t* peerstate = &global_state[sockfd];
-	peerstate->state = WAIT_FOR_MSG;
-	memset(peerstate->recv_buf, 0, 1024);
-	peerstate->buf_ptr = 0;
-	peerstate->buf_end = 0;
+/**
+ * @brief Free all chunks waiting in peer's output queue
+ *
+ * @param peer peer state
+ */
+static void output_queue_clear(peer_state_t *peer)
+{
+	struct output_chunk *chunk = peer->out_head;
+	while (chunk != NULL) {
+		struct output_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	peer->out_head = NULL;
+	peer->out_tail = NULL;
+	peer->out_pending = 0;
+}
 
-	// Signal that this socket is ready for read now.
-	return fd_status_R;
+/**
+ * @brief Append a copy of data at the end of peer's output queue
+ *
+ * @param peer peer state
+ * @param data data to send
+ * @param len length of data
+ * @return 0 on success, -ENOBUFS if peer's queue limit would be exceeded,
+ * -ENOMEM if allocation failed
+ */
+static int output_queue_push(peer_state_t *peer, const void *data, size_t len)
+{
+	struct output_chunk *chunk;
+
+	if (len == 0)
+		return 0;
+	if (peer->out_pending + len > OUTPUT_QUEUE_MAX_SIZE) {
+		log_warn("Monitoring: output queue of socket %d full (%zu bytes pending)",
+			peer->fd, peer->out_pending);
+		return -ENOBUFS;
+	}
+
+	chunk = malloc(sizeof(*chunk) + len);
+	if (chunk == NULL) {
+		log_error("Monitoring: Could not allocate memory for response");
+		return -ENOMEM;
+	}
+	chunk->next = NULL;
+	chunk->len = len;
+	chunk->offset = 0;
+	memcpy(chunk->data, data, len);
+
+	if (peer->out_tail != NULL)
+		peer->out_tail->next = chunk;
+	else
+		peer->out_head = chunk;
+	peer->out_tail = chunk;
+	peer->out_pending += len;
+	return 0;
 }
 
 /**
- * @brief Callback when ready to receive data from client
+ * @brief Send as much of peer's output queue as the socket accepts
  *
- * @param sockfd socket file descriptor
- * @return fd_status_t
+ * Chunks are gathered in a single sendmsg call. Chunks fully sent are
+ * removed from the queue, partially sent chunks keep track of the
+ * offset to resume from.
+ *
+ * @param peer peer state
+ * @return 0 when queue is empty or socket would block, -errno on error
  */
-static fd_status_t on_peer_ready_recv(int sockfd) {
-	assert(sockfd < MAXFDS);
-	peer_state_t* peerstate = &global_state[sockfd];
+static int output_queue_flush(peer_state_t *peer)
+{
+	while (peer->out_head != NULL) {
+		struct iovec iov[OUTPUT_QUEUE_MAX_IOV];
+		struct msghdr msg = {0};
+		struct output_chunk *chunk;
+		int iovcnt = 0;
+		ssize_t sent;
+
+		for (chunk = peer->out_head; chunk != NULL && iovcnt < OUTPUT_QUEUE_MAX_IOV;
+				chunk = chunk->next) {
+			iov[iovcnt].iov_base = chunk->data + chunk->offset;
+			iov[iovcnt].iov_len = chunk->len - chunk->offset;
+			iovcnt++;
+		}
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+
+		sent = sendmsg(peer->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			if (errno == EINTR)
+				continue;
+			log_error("Monitoring: Error sending response on socket %d: %s",
+				peer->fd, strerror(errno));
+			return -errno;
+		}
 
-	if (peerstate->state == INITIAL_ACK ||
-		peerstate->buf_ptr < peerstate->buf_end) {
-		// Until the initial ACK has been sent to the peer, there's nothing we
-		// want to receive. Also, wait until all data staged for sending is sent to
-		// receive more data.
-		return fd_status_R;
+		peer->out_pending -= sent;
+		while (sent > 0) {
+			chunk = peer->out_head;
+			size_t remaining = chunk->len - chunk->offset;
+			if ((size_t) sent < remaining) {
+				chunk->offset += sent;
+				/* Socket buffer is full, wait for EPOLLOUT */
+				return 0;
+			}
+			sent -= remaining;
+			peer->out_head = chunk->next;
+			if (peer->out_head == NULL)
+				peer->out_tail = NULL;
+			free(chunk);
+		}
 	}
+	return 0;
+}
 
-	char buf[1024];
-	int nbytes = recv(sockfd, buf, sizeof buf, 0);
-	if (nbytes == 0) {
-		// The peer disconnected.
-		return fd_status_NORW;
-	} else if (nbytes < 0) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK) {
-		// The socket is not *really* ready for recv; wait until it is.
-		return fd_status_R;
-		} else {
-			log_error("recv");
-			return fd_status_NORW;
+/**
+ * @brief Compute which events should be watched for a peer depending on
+ * its output queue
+ *
+ * Reading requests is paused while too much data is waiting to be sent so
+ * that a client not reading its responses cannot make the queue grow.
+ *
+ * @param peer peer state
+ * @return fd_status_t
+ */
+static fd_status_t peer_status(const peer_state_t *peer)
+{
+	return (fd_status_t){
+		.want_read = peer->out_pending <= OUTPUT_QUEUE_HIGH_WATERMARK,
+		.want_write = peer->out_pending > 0
+	};
+}
+
+/**
+ * @brief Take a peer state from the pool, allocating a new slab if needed
+ *
+ * @param pool peer pool
+ * @return peer_state_t* free peer state, NULL if maximum number of clients
+ * is reached or allocation failed
+ */
+static peer_state_t *peer_pool_get(struct peer_pool *pool)
+{
+	peer_state_t *peer;
+
+	if (pool->in_use >= pool->max_clients)
+		return NULL;
+
+	if (pool->free_list == NULL) {
+		struct peer_slab *slab = calloc(1, sizeof(struct peer_slab));
+		if (slab == NULL) {
+			log_error("Monitoring: Could not allocate memory for peer states");
+			return NULL;
+		}
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		for (int i = PEER_SLAB_SIZE - 1; i >= 0; i--) {
+			slab->peers[i].fd = -1;
+			slab->peers[i].next_free = pool->free_list;
+			pool->free_list = &slab->peers[i];
 		}
+		pool->allocated += PEER_SLAB_SIZE;
+		log_debug("Monitoring: %d peer states allocated", pool->allocated);
 	}
-	bool ready_to_send = false;
 
-	/** Store each byte received and try to parse it as a json
-	 * if we succeed to parse it as a json then we can analyse
-	 * and send the response
-	 */
-	for (int i = 0; i < nbytes; ++i) {
-		switch (peerstate->state) {
-		case INITIAL_ACK:
-			assert(0 && "can't reach here");
-			break;
-		case WAIT_FOR_MSG:
-			if (buf[i] == '{') {
-				peerstate->state = IN_MSG;
-				peerstate->recv_buf[0] = buf[i];
-				peerstate->buf_end++;
-			}
-			break;
-		case IN_MSG:
-			if (json_tokener_parse(peerstate->recv_buf)) {
-				peerstate->state = WAIT_FOR_MSG;
-				ready_to_send = true;
-			} else {
-				assert(peerstate->buf_end < SENDBUF_SIZE);
-				peerstate->recv_buf[peerstate->buf_end++] = buf[i];
+	peer = pool->free_list;
+	pool->free_list = peer->next_free;
+	peer->next_free = NULL;
+	peer->in_use = true;
+	pool->in_use++;
+	return peer;
+}
+
+/**
+ * @brief Give a peer state back to the pool
+ *
+ * @param pool peer pool
+ * @param peer peer state to release
+ */
+static void peer_pool_put(struct peer_pool *pool, peer_state_t *peer)
+{
+	output_queue_clear(peer);
+	peer->in_use = false;
+	peer->fd = -1;
+	peer->next_free = pool->free_list;
+	pool->free_list = peer;
+	pool->in_use--;
+}
+
+/**
+ * @brief Free all slabs of the pool, closing sockets of peers still connected
+ *
+ * @param pool peer pool
+ */
+static void peer_pool_destroy(struct peer_pool *pool)
+{
+	struct peer_slab *slab = pool->slabs;
+	while (slab != NULL) {
+		struct peer_slab *next = slab->next;
+		for (int i = 0; i < PEER_SLAB_SIZE; i++) {
+			if (slab->peers[i].in_use) {
+				output_queue_clear(&slab->peers[i]);
+				close(slab->peers[i].fd);
 			}
-			break;
 		}
+		free(slab);
+		slab = next;
 	}
+	memset(pool, 0, sizeof(*pool));
+}
 
-	if (json_tokener_parse(peerstate->recv_buf)) {
-		peerstate->state = WAIT_FOR_MSG;
-		ready_to_send = true;
+/**
+ * @brief Unregister peer's socket from epoll, close it and release peer state
+ *
+ * @param epollfd epoll file descriptor
+ * @param pool peer pool
+ * @param peer peer to close
+ */
+static void close_peer(int epollfd, struct peer_pool *pool, peer_state_t *peer)
+{
+	log_debug("socket %d closing", peer->fd);
+	if (epoll_ctl(epollfd, EPOLL_CTL_DEL, peer->fd, NULL) < 0)
+		log_error("epoll_ctl EPOLL_CTL_DEL");
+	close(peer->fd);
+	peer_pool_put(pool, peer);
+}
+
+/**
+ * @brief Close connections of peers which did not send any request for
+ * more than idle_timeout seconds
+ *
+ * @param epollfd epoll file descriptor
+ * @param pool peer pool
+ * @param idle_timeout timeout in seconds, 0 disables it
+ */
+static void close_idle_peers(int epollfd, struct peer_pool *pool, int idle_timeout)
+{
+	struct timespec now;
+
+	if (idle_timeout <= 0 || pool->in_use == 0)
+		return;
+
+	get_monotonic_time(&now);
+	for (struct peer_slab *slab = pool->slabs; slab != NULL; slab = slab->next) {
+		for (int i = 0; i < PEER_SLAB_SIZE; i++) {
+			peer_state_t *peer = &slab->peers[i];
+			if (peer->in_use && now.tv_sec - peer->last_activity.tv_sec >= idle_timeout) {
+				log_info("Monitoring: closing socket %d, idle for more than %ds",
+					peer->fd, idle_timeout);
+				close_peer(epollfd, pool, peer);
+			}
+		}
 	}
+}
 
-	// Report reading readiness iff there's nothing to analyse from the peer as a
-	// result of the latest recv.
-	return (fd_status_t){.want_read = !ready_to_send,
-						.want_write = ready_to_send};
+/**
+ * @brief Initialize receive buffer once peer is connected
+ *
+ * @param peerstate state taken from the peer pool for this connection
+ * @param sockfd socket file descriptor
+ * @param peer_addr
+ * @param peer_addr_len
+ * @return fd_status_t
+ */
+static fd_status_t on_peer_connected(peer_state_t *peerstate, int sockfd,
+									const struct sockaddr_in* peer_addr,
+									socklen_t peer_addr_len) {
+	// Initialize state to send back a '*' to the peer immediately.
+	peerstate->fd = sockfd;
+	peerstate->state = WAIT_FOR_MSG;
+	peerstate->protocol = PROTOCOL_UNKNOWN;
+	memset(peerstate->recv_buf, 0, SENDBUF_SIZE);
+	peerstate->buf_end = 0;
+	peerstate->out_head = NULL;
+	peerstate->out_tail = NULL;
+	peerstate->out_pending = 0;
+	get_monotonic_time(&peerstate->last_activity);
+
+	// Signal that this socket is ready for read now.
+	return fd_status_R;
 }
 
+
 static void json_add_float_array(struct json_object *json, char * array_name, float * array, int length) {
 	char array_str[256];
 	sprintf(array_str, "[");
@@ -413,6 +677,11 @@ static void json_handle_request(struct monitoring *monitoring, int request_type,
 			json_object_new_string("calibration"));
 		*mon_request = REQUEST_CALIBRATION;
 		break;
+	case REQUEST_CALIBRATION_ABORT:
+		json_object_object_add(resp, "Action requested",
+			json_object_new_string("calibration abort"));
+		*mon_request = REQUEST_CALIBRATION_ABORT;
+		break;
 	case REQUEST_GNSS_START:
 		json_object_object_add(resp, "Action requested",
 			json_object_new_string("GNSS start"));
@@ -483,6 +752,18 @@ static void json_handle_request(struct monitoring *monitoring, int request_type,
 			json_object_new_string("Ublox Serial reset"));
 		*mon_request = REQUEST_RESET_UBLOX_SERIAL;
 		break;
+	case REQUEST_HISTORY:
+		/* Handled by json_add_history_data, outside of monitoring lock */
+		break;
+	case REQUEST_GNSS_MESSAGES:
+		/* Handled by json_add_gnss_messages, under gnss_info lock */
+		break;
+	case REQUEST_GNSS_SIGNALS:
+		/* Handled by json_add_gnss_signals, under gnss_info lock */
+		break;
+	case REQUEST_BOOT_TIMELINE:
+		/* Handled by json_add_boot_timeline, under its own lock */
+		break;
 	case REQUEST_NONE:
 	default:
 		json_object_object_add(resp, "Action requested",
@@ -491,6 +772,143 @@ static void json_handle_request(struct monitoring *monitoring, int request_type,
 	}
 }
 
+/**
+ * @brief Add history points requested to the response
+ *
+ * Request may contain "start" and "end" timestamps (seconds since epoch) and
+ * a "resolution" (second, minute or hour). Last hour at a one second
+ * resolution is returned by default.
+ * At most HISTORY_MAX_POINTS, or HISTORY_MAX_SIZE bytes of points, are
+ * returned, if range contains more points "next" contains the timestamp to use
+ * as start of next request.
+ *
+ * @param resp json response
+ * @param history history
+ * @param req json request
+ */
+static void json_add_history_data(struct json_object *resp, struct history *history,
+	struct json_object *req)
+{
+	enum history_resolution resolution = HISTORY_RESOLUTION_SECOND;
+	const char *resolution_str = "second";
+	struct history_point *points;
+	struct json_object *value;
+	time_t end = time(NULL);
+	time_t start = end - HISTORY_DEFAULT_RANGE;
+	size_t size = 0;
+	int n;
+	int i;
+
+	if (json_object_object_get_ex(req, "end", &value))
+		end = json_object_get_int64(value);
+	if (json_object_object_get_ex(req, "start", &value))
+		start = json_object_get_int64(value);
+	if (json_object_object_get_ex(req, "resolution", &value)) {
+		resolution_str = json_object_get_string(value);
+		if (strcmp(resolution_str, "minute") == 0) {
+			resolution = HISTORY_RESOLUTION_MINUTE;
+		} else if (strcmp(resolution_str, "hour") == 0) {
+			resolution = HISTORY_RESOLUTION_HOUR;
+		} else if (strcmp(resolution_str, "second") != 0) {
+			json_object_object_add(resp, "history",
+				json_object_new_string("invalid resolution"));
+			return;
+		}
+	}
+
+	/* One more point than sent is fetched to know if range is truncated */
+	points = malloc((HISTORY_MAX_POINTS + 1) * sizeof(struct history_point));
+	if (points == NULL) {
+		log_error("Monitoring: Could not allocate memory for history");
+		return;
+	}
+	n = history_query(history, start, end, resolution, points, HISTORY_MAX_POINTS + 1);
+	if (n < 0) {
+		json_object_object_add(resp, "history",
+			json_object_new_string("unavailable"));
+		free(points);
+		return;
+	}
+
+	struct json_object *history_json = json_object_new_object();
+	struct json_object *points_json = json_object_new_array();
+	json_object_object_add(history_json, "resolution",
+		json_object_new_string(resolution_str));
+	json_object_object_add(history_json, "start", json_object_new_int64(start));
+	json_object_object_add(history_json, "end", json_object_new_int64(end));
+
+	for (i = 0; i < n && i < HISTORY_MAX_POINTS; i++) {
+		struct json_object *point = json_object_new_object();
+		json_object_object_add(point, "timestamp",
+			json_object_new_int64(points[i].timestamp));
+		for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+			const struct history_stats *stats = &points[i].stats[m];
+			if (resolution == HISTORY_RESOLUTION_SECOND) {
+				json_object_object_add(point, history_metric_name(m),
+					json_object_new_double(stats->mean));
+				continue;
+			}
+			struct json_object *metric = json_object_new_object();
+			json_object_object_add(metric, "min", json_object_new_double(stats->min));
+			json_object_object_add(metric, "max", json_object_new_double(stats->max));
+			json_object_object_add(metric, "mean", json_object_new_double(stats->mean));
+			json_object_object_add(metric, "stddev",
+				json_object_new_double(history_stats_stddev(stats)));
+			json_object_object_add(point, history_metric_name(m), metric);
+		}
+		/* Stop before the page outgrows the budget, at least one point is sent */
+		size += strlen(json_object_to_json_string(point)) + 1;
+		if (i > 0 && size > HISTORY_MAX_SIZE) {
+			json_object_put(point);
+			break;
+		}
+		json_object_array_add(points_json, point);
+	}
+	if (i < n)
+		json_object_object_add(history_json, "next",
+			json_object_new_int64(points[i].timestamp));
+	json_object_object_add(history_json, "points", points_json);
+	json_object_object_add(resp, "history", history_json);
+	free(points);
+}
+
+/**
+ * @brief Add start up timeline to the response
+ *
+ * Milestones are in seconds since oscillatord started, null if not reached.
+ *
+ * @param resp json response
+ */
+static void json_add_boot_timeline(struct json_object *resp)
+{
+	struct boot_timeline timeline;
+
+	boot_timeline_get(&timeline);
+
+	struct json_object *timeline_json = json_object_new_object();
+	struct json_object *milestones = json_object_new_object();
+	struct json_object *transitions = json_object_new_array();
+	json_object_object_add(timeline_json, "start",
+		json_object_new_int64(timeline.start_realtime.tv_sec));
+	for (int i = 0; i < BOOT_MILESTONE_NUM; i++)
+		json_object_object_add(milestones, cstring_from_boot_milestone(i),
+			timeline.milestones[i] >= 0.0 ?
+			json_object_new_double(timeline.milestones[i]) : NULL);
+	json_object_object_add(timeline_json, "milestones", milestones);
+	for (int i = 0; i < timeline.transitions_count; i++) {
+		struct json_object *transition = json_object_new_object();
+		json_object_object_add(transition, "state", json_object_new_string(
+			cstring_from_disciplining_state(timeline.transitions[i].state)));
+		json_object_object_add(transition, "elapsed",
+			json_object_new_double(timeline.transitions[i].elapsed));
+		json_object_array_add(transitions, transition);
+	}
+	json_object_object_add(timeline_json, "transitions", transitions);
+	json_object_object_add(timeline_json, "transitions_dropped",
+		json_object_new_int(timeline.transitions_dropped));
+	json_object_object_add(resp, "boot_timeline", timeline_json);
+}
+
 static void json_add_clock_data(struct json_object *resp, struct monitoring *monitoring)
 {
 	struct json_object *clock = json_object_new_object();
@@ -499,11 +917,51 @@ static void json_add_clock_data(struct json_object *resp, struct monitoring *mon
 	);
 	json_object_object_add(clock, "offset",
 		json_object_new_int(monitoring->osc_attributes.phase_error));
+	json_object_object_add(clock, "offset_corrected",
+		json_object_new_double(monitoring->phase_error_corrected));
+	json_object_object_add(clock, "qerr_matched",
+		json_object_new_boolean(monitoring->qerr_matched));
 
 	json_object_object_add(resp, "clock", clock);
 
 }
 
+/**
+ * @brief Add progress of calibration to disciplining data
+ *
+ * Progress counts control points done and measures done at current one,
+ * settling time is not accounted for.
+ *
+ * @param disciplining
+ * @param calibration copy of main loop's calibration
+ */
+static void json_add_calibration_data(struct json_object *disciplining,
+	const struct oscillator_calibration *calibration)
+{
+	struct json_object *calib = json_object_new_object();
+	double progress = 0.0;
+
+	if (calibration->state == CALIBRATION_DONE)
+		progress = 1.0;
+	else if (calibration->points > 0 && calibration->measures > 0)
+		progress = (calibration->point + (double) calibration->measure / calibration->measures) /
+			calibration->points;
+
+	json_object_object_add(calib, "state",
+		json_object_new_string(cstring_from_calibration_state(calibration->state)));
+	json_object_object_add(calib, "control_point",
+		json_object_new_int(calibration->point));
+	json_object_object_add(calib, "control_points",
+		json_object_new_int(calibration->points));
+	json_object_object_add(calib, "measure",
+		json_object_new_int(calibration->measure));
+	json_object_object_add(calib, "measures",
+		json_object_new_int(calibration->measures));
+	json_object_object_add(calib, "progress",
+		json_object_new_double(progress));
+	json_object_object_add(disciplining, "calibration", calib);
+}
+
 /**
  * @brief Add disciplining data to json response
  *
@@ -538,6 +996,7 @@ static void json_add_disciplining_data(struct json_object *resp, struct monitori
 			monitoring->disciplining.ready_for_holdover ? "true" : "false"
 		)
 	);
+	json_add_calibration_data(disciplining, &monitoring->calibration);
 	json_object_object_add(resp, "disciplining", disciplining);
 }
 
@@ -589,29 +1048,162 @@ static void json_add_gnss_data(struct json_object *resp, struct monitoring *moni
 		json_object_new_int(monitoring->gnss_info.satellites_count));
 	json_object_object_add(gnss, "survey_in_position_error",
 		json_object_new_int(monitoring->gnss_info.survey_in_position_error));
+	json_object_object_add(gnss, "receiver",
+		json_object_new_int(monitoring->gnss_info.receiver));
+	json_object_object_add(gnss, "receivers_count",
+		json_object_new_int(monitoring->gnss_info.receivers_count));
 
 	json_object_object_add(resp, "gnss", gnss);
 }
 
 /**
- * @brief Analyse request and send response
+ * @brief Add counters of messages received from GNSS receiver to json
+ * response. Must be called under gnss_info.lock locked
  *
- * @param sockfd socket file descriptor
+ * Rate is the number of messages per second between first and last message
+ * of each type.
+ *
+ * @param resp
+ * @param monitoring
+ */
+static void json_add_gnss_messages(struct json_object *resp, struct monitoring *monitoring)
+{
+	struct json_object *messages = json_object_new_array();
+
+	for (int i = 0; i < GNSS_MSG_STATS_MAX; i++) {
+		const struct gnss_msg_stats *stats = &monitoring->gnss_info.msg_stats[i];
+		struct json_object *message;
+		double elapsed;
+
+		if (stats->key == 0 || stats->count == 0)
+			continue;
+		elapsed = (stats->last.tv_sec - stats->first.tv_sec) +
+			(stats->last.tv_nsec - stats->first.tv_nsec) / 1e9;
+
+		message = json_object_new_object();
+		json_object_object_add(message, "name",
+			json_object_new_string(stats->name));
+		json_object_object_add(message, "count",
+			json_object_new_int64(stats->count));
+		json_object_object_add(message, "bytes",
+			json_object_new_int64(stats->bytes));
+		json_object_object_add(message, "mean_parse_ns",
+			json_object_new_int64(stats->parse_ns / stats->count));
+		json_object_object_add(message, "max_parse_ns",
+			json_object_new_int64(stats->max_parse_ns));
+		json_object_object_add(message, "rate",
+			json_object_new_double(elapsed > 0 ? (stats->count - 1) / elapsed : 0.0));
+		json_object_array_add(messages, message);
+	}
+
+	json_object_object_add(resp, "gnss_messages", messages);
+}
+
+static const char *gnss_sky_names[GNSS_SKY_GNSS_MAX] = {
+	"GPS", "SBAS", "Galileo", "BeiDou", "IMES", "QZSS", "GLONASS", "NavIC"
+};
+
+static struct json_object *json_new_int_array(const uint8_t *values, int count)
+{
+	struct json_object *array = json_object_new_array();
+
+	for (int i = 0; i < count; i++)
+		json_object_array_add(array, json_object_new_int(values[i]));
+	return array;
+}
+
+/**
+ * @brief Add satellites and signals tracked by GNSS receiver to json
+ * response. Must be called under gnss_info.lock locked
+ *
+ * C/N0 histograms have 10 dBHz wide bins, last one gathers signals above
+ * 50 dBHz. Elevation histograms bins are unknown, 0-15, 15-30, 30-60 and
+ * 60-90 degrees. Constellations and signals not tracked are omitted.
+ *
+ * @param resp
+ * @param monitoring
+ */
+static void json_add_gnss_signals(struct json_object *resp, struct monitoring *monitoring)
+{
+	const struct gnss_sky *sky = &monitoring->gnss_info.sky;
+	struct json_object *signals = json_object_new_object();
+	struct json_object *constellations = json_object_new_array();
+
+	for (int i = 0; i < GNSS_SKY_GNSS_MAX; i++) {
+		const struct gnss_sky_sat *sat = &sky->sats[i];
+		struct json_object *constellation;
+		struct json_object *sigs;
+
+		if (sat->tracked == 0 && sky->sigs[i][0].tracked == 0)
+			continue;
+		constellation = json_object_new_object();
+		json_object_object_add(constellation, "name",
+			json_object_new_string(gnss_sky_names[i]));
+		json_object_object_add(constellation, "tracked",
+			json_object_new_int(sat->tracked));
+		json_object_object_add(constellation, "used",
+			json_object_new_int(sat->used));
+		json_object_object_add(constellation, "mean_cno",
+			json_object_new_double(sat->tracked > 0 ? (double) sat->cno_sum / sat->tracked : 0.0));
+		json_object_object_add(constellation, "cno_histogram",
+			json_new_int_array(sat->cno, GNSS_SKY_CNO_BINS));
+		json_object_object_add(constellation, "elevation_histogram",
+			json_new_int_array(sat->elev, GNSS_SKY_ELEV_BINS));
+		json_object_object_add(constellation, "used_elevation_histogram",
+			json_new_int_array(sat->used_elev, GNSS_SKY_ELEV_BINS));
+
+		sigs = json_object_new_array();
+		for (int j = 0; j < GNSS_SKY_SIG_MAX; j++) {
+			const struct gnss_sky_sig *sig = &sky->sigs[i][j];
+			struct json_object *signal;
+
+			if (sig->tracked == 0)
+				continue;
+			signal = json_object_new_object();
+			json_object_object_add(signal, "sig_id", json_object_new_int(j));
+			json_object_object_add(signal, "tracked",
+				json_object_new_int(sig->tracked));
+			json_object_object_add(signal, "used",
+				json_object_new_int(sig->used));
+			json_object_object_add(signal, "mean_cno",
+				json_object_new_double((double) sig->cno_sum / sig->tracked));
+			json_object_object_add(signal, "cno_histogram",
+				json_new_int_array(sig->cno, GNSS_SKY_CNO_BINS));
+			json_object_array_add(sigs, signal);
+		}
+		json_object_object_add(constellation, "signals", sigs);
+		json_object_array_add(constellations, constellation);
+	}
+
+	json_object_object_add(signals, "nav_sat_itow",
+		json_object_new_int64(sky->sat_itow));
+	json_object_object_add(signals, "nav_sig_itow",
+		json_object_new_int64(sky->sig_itow));
+	json_object_object_add(signals, "nav_sat_count",
+		json_object_new_int64(sky->sat_updates));
+	json_object_object_add(signals, "nav_sig_count",
+		json_object_new_int64(sky->sig_updates));
+	json_object_object_add(signals, "constellations", constellations);
+	json_object_object_add(resp, "gnss_signals", signals);
+}
+
+/**
+ * @brief Handle a request received from a peer and queue the response
+ *
+ * @param peerstate state of the peer
  * @param monitoring monitoring struct pointer
- * @return fd_status_t
+ * @param obj json request received
+ * @return 0 on success, negative error code if response could not be queued
  */
-static fd_status_t on_peer_ready_send(int sockfd, struct monitoring * monitoring) {
+static int queue_response(peer_state_t *peerstate, struct monitoring *monitoring,
+	struct json_object *obj)
+{
 	enum monitoring_request request_type = REQUEST_NONE;
-	struct json_object *json_req;
+	struct json_object *json_req = NULL;
 	struct json_object *json_resp;
+	const char *resp;
 	int ret;
 
-	assert(sockfd < MAXFDS);
-	peer_state_t* peerstate = &global_state[sockfd];
-
-	struct json_object *obj = json_tokener_parse(peerstate->recv_buf);
-	memset(peerstate->recv_buf, 0, 1024);
-
 	json_object_object_get_ex(obj, "request", &json_req);
 
 	/* Notify main loop about the request */
@@ -632,30 +1224,257 @@ static fd_status_t on_peer_ready_send(int sockfd, struct monitoring * monitoring
 
 	pthread_mutex_lock(&monitoring->gnss_info.lock);
 	json_add_gnss_data(json_resp, monitoring);
+	if (request_type == REQUEST_GNSS_MESSAGES)
+		json_add_gnss_messages(json_resp, monitoring);
+	else if (request_type == REQUEST_GNSS_SIGNALS)
+		json_add_gnss_signals(json_resp, monitoring);
 	pthread_mutex_unlock(&monitoring->gnss_info.lock);
 
-	const char *resp = json_object_to_json_string(json_resp);
-	json_object_object_del(json_resp, "disciplining");
-	json_object_object_del(json_resp, "gnss");
-	json_object_object_del(json_resp, "oscillator");
-	json_object_object_del(json_resp, "disciplining_parameters");
-	ret = send(sockfd, resp, strlen(resp), 0);
-	if (ret == -1) {
-		log_error("Monitoring: Error sending response: %d", ret);
-		return fd_status_W;
+	if (request_type == REQUEST_HISTORY)
+		json_add_history_data(json_resp, monitoring->history, obj);
+	else if (request_type == REQUEST_BOOT_TIMELINE)
+		json_add_boot_timeline(json_resp);
 
-	} else {
-		// Everything was sent successfully; reset the send queue.
-		peerstate->buf_ptr = 0;
-		peerstate->buf_end = 0;
+	resp = json_object_to_json_string(json_resp);
+	ret = output_queue_push(peerstate, resp, strlen(resp));
+	json_object_put(json_resp);
 
-		// Special-case state transition in if we were in INITIAL_ACK until now.
-		if (peerstate->state == INITIAL_ACK) {
-			peerstate->state = WAIT_FOR_MSG;
+	return ret;
+}
+
+/**
+ * @brief Tell if a request asks oscillatord's main loop to perform an action
+ *
+ * @param request_type request received
+ * @return true if request must be forwarded to the main loop
+ */
+static bool is_action_request(int request_type)
+{
+	switch (request_type) {
+	case REQUEST_CALIBRATION:
+	case REQUEST_CALIBRATION_ABORT:
+	case REQUEST_GNSS_START:
+	case REQUEST_GNSS_STOP:
+	case REQUEST_GNSS_SOFT:
+	case REQUEST_GNSS_HARD:
+	case REQUEST_GNSS_COLD:
+	case REQUEST_SAVE_EEPROM:
+	case REQUEST_FAKE_HOLDOVER_START:
+	case REQUEST_FAKE_HOLDOVER_STOP:
+	case REQUEST_MRO_COARSE_INC:
+	case REQUEST_MRO_COARSE_DEC:
+	case REQUEST_RESET_UBLOX_SERIAL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief Handle a binary request received from a peer and queue the response
+ *
+ * Binary protocol only carries the data set common to all json responses,
+ * EEPROM content requested with REQUEST_READ_EEPROM is only sent over json.
+ *
+ * @param peerstate state of the peer
+ * @param monitoring monitoring struct pointer
+ * @param req binary request received
+ * @return 0 on success, negative error code if response could not be queued
+ */
+static int queue_binary_response(peer_state_t *peerstate, struct monitoring *monitoring,
+	const struct monitoring_bin_request *req)
+{
+	struct monitoring_bin_response resp;
+	int request_type = le16toh(req->request);
+
+	memset(&resp, 0, sizeof(resp));
+	memcpy(resp.magic, MONITORING_BIN_MAGIC, MONITORING_BIN_MAGIC_LEN);
+	resp.version = MONITORING_BIN_VERSION;
+	resp.length = htole16(sizeof(resp));
+	resp.request = htole16(request_type);
+
+	if (req->version != MONITORING_BIN_VERSION) {
+		log_warn("Monitoring: binary request version %u is not supported", req->version);
+		resp.flags |= MONITORING_BIN_FLAG_BAD_VERSION;
+		return output_queue_push(peerstate, &resp, sizeof(resp));
+	}
+
+	pthread_mutex_lock(&monitoring->mutex);
+	if (is_action_request(request_type)) {
+		monitoring->request = request_type;
+		resp.flags |= MONITORING_BIN_FLAG_ACTION;
+	}
+
+	resp.clock_class = monitoring->disciplining.clock_class;
+	resp.clock_offset = htole32(monitoring->osc_attributes.phase_error);
+
+	if (monitoring->oscillator_model != NULL)
+		strncpy(resp.oscillator_model, monitoring->oscillator_model,
+			MONITORING_BIN_MODEL_LEN - 1);
+	resp.fine_ctrl = htole32(monitoring->ctrl_values.fine_ctrl);
+	resp.coarse_ctrl = htole32(monitoring->ctrl_values.coarse_ctrl);
+	resp.lock = monitoring->osc_attributes.locked;
+	resp.temperature = htole32((int32_t) (monitoring->osc_attributes.temperature * 1000.0));
+
+	if (monitoring->disciplining_mode || monitoring->phase_error_supported) {
+		resp.flags |= MONITORING_BIN_FLAG_DISCIPLINING;
+		resp.status = monitoring->disciplining.status;
+		resp.ready_for_holdover = monitoring->disciplining.ready_for_holdover;
+		resp.current_phase_convergence_count =
+			htole32(monitoring->disciplining.current_phase_convergence_count);
+		resp.valid_phase_convergence_threshold =
+			htole32(monitoring->disciplining.valid_phase_convergence_threshold);
+		resp.convergence_progress =
+			htole16((uint16_t) (monitoring->disciplining.convergence_progress * 100.0));
+	}
+	pthread_mutex_unlock(&monitoring->mutex);
+
+	pthread_mutex_lock(&monitoring->gnss_info.lock);
+	resp.fix = monitoring->gnss_info.fix;
+	resp.fix_ok = monitoring->gnss_info.fixOk;
+	resp.antenna_power = monitoring->gnss_info.antenna_power;
+	resp.antenna_status = monitoring->gnss_info.antenna_status;
+	resp.ls_change = monitoring->gnss_info.lsChange;
+	resp.leap_seconds = htole16(monitoring->gnss_info.leap_seconds);
+	resp.satellites_count = monitoring->gnss_info.satellites_count;
+	/* Error is negative until a survey in is done or a position is reused */
+	resp.survey_in_position_error = htole32(monitoring->gnss_info.survey_in_position_error < 0.0 ?
+		-1 : (int32_t) (monitoring->gnss_info.survey_in_position_error * 1000.0));
+	pthread_mutex_unlock(&monitoring->gnss_info.lock);
+
+	return output_queue_push(peerstate, &resp, sizeof(resp));
+}
+
+/**
+ * @brief Callback when ready to receive data from client
+ *
+ * Each complete json request received is answered right away by queuing
+ * the response in peer's output queue, which is then flushed as much as
+ * the socket allows.
+ *
+ * @param peerstate state of the peer
+ * @param monitoring monitoring struct pointer
+ * @return fd_status_t
+ */
+static fd_status_t on_peer_ready_recv(peer_state_t *peerstate, struct monitoring *monitoring) {
+	int sockfd = peerstate->fd;
+
+	if (peerstate->state == INITIAL_ACK ||
+		peerstate->out_pending > OUTPUT_QUEUE_HIGH_WATERMARK) {
+		// Until the initial ACK has been sent to the peer, there's nothing we
+		// want to receive. Also, wait until enough staged data is sent to
+		// receive more requests.
+		return peer_status(peerstate);
+	}
+
+	char buf[1024];
+	int nbytes = recv(sockfd, buf, sizeof buf, 0);
+	if (nbytes == 0) {
+		// The peer disconnected.
+		return fd_status_NORW;
+	} else if (nbytes < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		// The socket is not *really* ready for recv; wait until it is.
+		return peer_status(peerstate);
+		} else {
+			log_error("recv");
+			return fd_status_NORW;
 		}
+	}
+	get_monotonic_time(&peerstate->last_activity);
+
+	/** Store each byte received and try to parse it as a json
+	 * when it may be complete. Once we succeed to parse it as a json
+	 * then we can analyse it and queue the response.
+	 * First request received selects the protocol used by the peer.
+	 */
+	for (int i = 0; i < nbytes; ++i) {
+		switch (peerstate->state) {
+		case INITIAL_ACK:
+			assert(0 && "can't reach here");
+			break;
+		case WAIT_FOR_MSG:
+			if (buf[i] == '{' && peerstate->protocol != PROTOCOL_BINARY) {
+				peerstate->protocol = PROTOCOL_JSON;
+				peerstate->state = IN_MSG;
+				peerstate->recv_buf[0] = buf[i];
+				peerstate->recv_buf[1] = '\0';
+				peerstate->buf_end = 1;
+			} else if (buf[i] == MONITORING_BIN_MAGIC[0] &&
+				peerstate->protocol != PROTOCOL_JSON) {
+				peerstate->state = IN_BIN_MSG;
+				peerstate->recv_buf[0] = buf[i];
+				peerstate->buf_end = 1;
+			}
+			break;
+		case IN_BIN_MSG:
+			peerstate->recv_buf[peerstate->buf_end++] = buf[i];
+			if (peerstate->buf_end == MONITORING_BIN_MAGIC_LEN &&
+				memcmp(peerstate->recv_buf, MONITORING_BIN_MAGIC,
+					MONITORING_BIN_MAGIC_LEN) != 0) {
+				log_warn("Monitoring: invalid binary request on socket %d", sockfd);
+				return fd_status_NORW;
+			}
+			if (peerstate->buf_end < (int) sizeof(struct monitoring_bin_request))
+				break;
 
-		return fd_status_R;
+			if (peerstate->protocol == PROTOCOL_UNKNOWN) {
+				log_debug("Monitoring: socket %d uses binary protocol", sockfd);
+				peerstate->protocol = PROTOCOL_BINARY;
+			}
+			struct monitoring_bin_request req;
+			memcpy(&req, peerstate->recv_buf, sizeof(req));
+			peerstate->state = WAIT_FOR_MSG;
+			peerstate->buf_end = 0;
+			if (queue_binary_response(peerstate, monitoring, &req) < 0)
+				return fd_status_NORW;
+			break;
+		case IN_MSG:
+			if (peerstate->buf_end >= SENDBUF_SIZE - 1) {
+				log_warn("Monitoring: request too long on socket %d", sockfd);
+				return fd_status_NORW;
+			}
+			peerstate->recv_buf[peerstate->buf_end++] = buf[i];
+			peerstate->recv_buf[peerstate->buf_end] = '\0';
+			if (buf[i] != '}')
+				break;
+
+			struct json_object *obj = json_tokener_parse(peerstate->recv_buf);
+			if (obj != NULL) {
+				int ret = queue_response(peerstate, monitoring, obj);
+				json_object_put(obj);
+				peerstate->state = WAIT_FOR_MSG;
+				peerstate->buf_end = 0;
+				if (ret < 0)
+					return fd_status_NORW;
+			}
+			break;
+		}
 	}
+
+	if (output_queue_flush(peerstate) < 0)
+		return fd_status_NORW;
+
+	return peer_status(peerstate);
+}
+
+/**
+ * @brief Callback when socket is ready to send data to client
+ *
+ * Only watched while peer's output queue is not empty
+ *
+ * @param peerstate state of the peer
+ * @return fd_status_t
+ */
+static fd_status_t on_peer_ready_send(peer_state_t *peerstate) {
+	if (output_queue_flush(peerstate) < 0)
+		return fd_status_NORW;
+
+	// Special-case state transition in if we were in INITIAL_ACK until now.
+	if (peerstate->out_pending == 0 && peerstate->state == INITIAL_ACK)
+		peerstate->state = WAIT_FOR_MSG;
+
+	return peer_status(peerstate);
 }
 
 /**
@@ -706,6 +1525,28 @@ struct monitoring* monitoring_init(const struct config *config, struct devices_p
 		return NULL;
 	}
 
+	monitoring->max_clients = config_get_unsigned_number(config, "monitoring-max-clients");
+	if (monitoring->max_clients <= 0)
+		monitoring->max_clients = DEFAULT_MAX_CLIENTS;
+	monitoring->idle_timeout = config_get_unsigned_number(config, "monitoring-idle-timeout");
+	if (monitoring->idle_timeout < 0)
+		monitoring->idle_timeout = DEFAULT_IDLE_TIMEOUT_S;
+	log_debug("Monitoring: up to %d clients, idle timeout %ds",
+		monitoring->max_clients, monitoring->idle_timeout);
+
+	monitoring->history = history_new(config);
+	if (monitoring->history == NULL)
+		log_warn("Monitoring: history disabled");
+
+	monitoring->shm = NULL;
+	monitoring->shm_updates = 0;
+	monitoring->shm_name = config_get(config, "monitoring-shm");
+	if (monitoring->shm_name != NULL) {
+		monitoring->shm = monitoring_shm_create(monitoring->shm_name);
+		if (monitoring->shm == NULL)
+			log_warn("Monitoring: shared memory export disabled");
+	}
+
 	monitoring->stop = false;
 	monitoring->disciplining_mode = config_get_bool_default(config, "disciplining", false);
 	monitoring->phase_error_supported = false;
@@ -722,6 +1563,8 @@ struct monitoring* monitoring_init(const struct config *config, struct devices_p
 	monitoring->osc_attributes.locked = false;
 	monitoring->osc_attributes.temperature = -400.0;
 	monitoring->osc_attributes.phase_error = 0;
+	monitoring->phase_error_corrected = 0.0;
+	monitoring->qerr_matched = false;
 
 	monitoring->gnss_info.antenna_power = -1;
 	monitoring->gnss_info.antenna_status = -1;
@@ -731,6 +1574,8 @@ struct monitoring* monitoring_init(const struct config *config, struct devices_p
 	monitoring->gnss_info.lsChange = -10;
 	monitoring->gnss_info.satellites_count = -1;
 	monitoring->gnss_info.survey_in_position_error = -1.0;
+	monitoring->gnss_info.receiver = 0;
+	monitoring->gnss_info.receivers_count = 1;
 	pthread_mutex_init(&monitoring->gnss_info.lock, NULL);
 
 	pthread_mutex_init(&monitoring->mutex, NULL);
@@ -739,6 +1584,8 @@ struct monitoring* monitoring_init(const struct config *config, struct devices_p
 	monitoring->sockfd = listen_inet_socket(address, port);
 	if (monitoring->sockfd == -1) {
 		log_error("Monitoring: Error creating monitoring socket");
+		history_destroy(&monitoring->history);
+		monitoring_shm_destroy(monitoring->shm, monitoring->shm_name);
 		free(monitoring);
 		return NULL;
 	}
@@ -759,6 +1606,8 @@ struct monitoring* monitoring_init(const struct config *config, struct devices_p
 	if (ret != 0) {
 		log_error("Monitoring: Error creating monitoring thread: %d", ret);
 		close(monitoring->sockfd);
+		history_destroy(&monitoring->history);
+		monitoring_shm_destroy(monitoring->shm, monitoring->shm_name);
 		free(monitoring);
 		return NULL;
 	}
@@ -780,10 +1629,62 @@ void monitoring_stop(struct monitoring *monitoring)
 	pthread_mutex_unlock(&monitoring->mutex);
 	pthread_join(monitoring->thread, NULL);
 	close(monitoring->sockfd);
+	history_destroy(&monitoring->history);
+	monitoring_shm_destroy(monitoring->shm, monitoring->shm_name);
 	free(monitoring);
 	return;
 }
 
+/**
+ * @brief Publish current monitoring values in shared memory
+ *
+ * Called by main loop after each update of the monitoring values
+ *
+ * @param monitoring monitoring struct pointer
+ */
+void monitoring_export(struct monitoring *monitoring)
+{
+	struct monitoring_shm_snapshot snapshot = {0};
+
+	if (monitoring == NULL || monitoring->shm == NULL)
+		return;
+
+	snapshot.timestamp = time(NULL);
+	snapshot.update_count = ++monitoring->shm_updates;
+
+	pthread_mutex_lock(&monitoring->mutex);
+	snapshot.clock_class = monitoring->disciplining.clock_class;
+	snapshot.phase_error = monitoring->osc_attributes.phase_error;
+	snapshot.fine_ctrl = monitoring->ctrl_values.fine_ctrl;
+	snapshot.coarse_ctrl = monitoring->ctrl_values.coarse_ctrl;
+	snapshot.locked = monitoring->osc_attributes.locked;
+	snapshot.temperature = monitoring->osc_attributes.temperature;
+	if (monitoring->disciplining_mode || monitoring->phase_error_supported) {
+		snapshot.disciplining_valid = 1;
+		snapshot.status = monitoring->disciplining.status;
+		snapshot.current_phase_convergence_count =
+			monitoring->disciplining.current_phase_convergence_count;
+		snapshot.valid_phase_convergence_threshold =
+			monitoring->disciplining.valid_phase_convergence_threshold;
+		snapshot.convergence_progress = monitoring->disciplining.convergence_progress;
+		snapshot.ready_for_holdover = monitoring->disciplining.ready_for_holdover;
+	}
+	pthread_mutex_unlock(&monitoring->mutex);
+
+	pthread_mutex_lock(&monitoring->gnss_info.lock);
+	snapshot.fix = monitoring->gnss_info.fix;
+	snapshot.fix_ok = monitoring->gnss_info.fixOk;
+	snapshot.antenna_power = monitoring->gnss_info.antenna_power;
+	snapshot.antenna_status = monitoring->gnss_info.antenna_status;
+	snapshot.satellites_count = monitoring->gnss_info.satellites_count;
+	snapshot.leap_seconds = monitoring->gnss_info.leap_seconds;
+	snapshot.ls_change = monitoring->gnss_info.lsChange;
+	snapshot.survey_in_position_error = monitoring->gnss_info.survey_in_position_error;
+	pthread_mutex_unlock(&monitoring->gnss_info.lock);
+
+	monitoring_shm_publish(monitoring->shm, &snapshot);
+}
+
 /**
  * @brief Monitoring thread routine
  *
@@ -804,15 +1705,24 @@ static void *monitoring_thread(void * p_data)
 		return NULL;
 	}
 
+	struct peer_pool pool = {
+		.slabs = NULL,
+		.free_list = NULL,
+		.allocated = 0,
+		.in_use = 0,
+		.max_clients = monitoring->max_clients,
+	};
+	/* Listening socket is identified by a NULL peer state */
 	struct epoll_event accept_event;
-	accept_event.data.fd = monitoring->sockfd;
+	accept_event.data.ptr = NULL;
 	accept_event.events = EPOLLIN;
 	if (epoll_ctl(epollfd, EPOLL_CTL_ADD, monitoring->sockfd, &accept_event) < 0) {
 		log_error("epoll_ctl EPOLL_CTL_ADD");
 		return NULL;
 	}
 
-	struct epoll_event* events = calloc(MAXFDS, sizeof(struct epoll_event));
+	int max_events = monitoring->max_clients + 1;
+	struct epoll_event* events = calloc(max_events, sizeof(struct epoll_event));
 	if (events == NULL) {
 		log_error("Unable to allocate memory for epoll_events");
 		return NULL;
@@ -821,20 +1731,21 @@ static void *monitoring_thread(void * p_data)
 	while (!stop)
 	{
 		log_trace("Monitoring: Listening on socket...");
-		int nready = epoll_wait(epollfd, events, MAXFDS, SOCKET_TIMEOUT_MS);
+		int nready = epoll_wait(epollfd, events, max_events, SOCKET_TIMEOUT_MS);
 		for (int i = 0; i < nready; i++) {
+			peer_state_t *peer = events[i].data.ptr;
+
 			if (events[i].events & EPOLLERR) {
 				log_error("received EPOLLERR");
-				log_debug("socket %d closing", events[i].data.fd);
-				if (epoll_ctl(epollfd, EPOLL_CTL_DEL, events[i].data.fd, NULL) < 0) {
-					log_error("epoll_ctl EPOLL_CTL_DEL");
-					return NULL;
+				if (peer == NULL) {
+					log_error("Monitoring: error on listening socket");
+					goto exit;
 				}
-				close(events[i].data.fd);
+				close_peer(epollfd, &pool, peer);
 				continue;
 			}
 
-			if (events[i].data.fd == monitoring->sockfd) {
+			if (peer == NULL) {
 				// The listening socket is ready; this means a new peer is connecting.
 
 				struct sockaddr_in peer_addr;
@@ -849,19 +1760,22 @@ static void *monitoring_thread(void * p_data)
 						log_debug("accept returned EAGAIN or EWOULDBLOCK");
 					} else {
 						log_error("accept");
-						return NULL;
+						goto exit;
 					}
 				} else {
-					make_socket_non_blocking(newsockfd);
-					if (newsockfd >= MAXFDS) {
-						log_error("socket fd (%d) >= MAXFDS (%d)", newsockfd, MAXFDS);
-						return NULL;
+					peer_state_t *new_peer = peer_pool_get(&pool);
+					if (new_peer == NULL) {
+						log_warn("Monitoring: maximum number of clients (%d) reached, "
+							"rejecting connection", pool.max_clients);
+						close(newsockfd);
+						continue;
 					}
+					make_socket_non_blocking(newsockfd);
 
 					fd_status_t status =
-						on_peer_connected(newsockfd, &peer_addr, peer_addr_len);
+						on_peer_connected(new_peer, newsockfd, &peer_addr, peer_addr_len);
 					struct epoll_event event = {0};
-					event.data.fd = newsockfd;
+					event.data.ptr = new_peer;
 					if (status.want_read) {
 						event.events |= EPOLLIN;
 					}
@@ -871,66 +1785,49 @@ static void *monitoring_thread(void * p_data)
 
 					if (epoll_ctl(epollfd, EPOLL_CTL_ADD, newsockfd, &event) < 0) {
 						log_error("epoll_ctl EPOLL_CTL_ADD");
-						return NULL;
+						close(newsockfd);
+						peer_pool_put(&pool, new_peer);
 					}
 				}
 			} else {
 				// A peer socket is ready.
-				if (events[i].events & EPOLLIN) {
+				fd_status_t status;
+				if (events[i].events & EPOLLOUT) {
+					// Ready for writing, drain pending responses first.
+					status = on_peer_ready_send(peer);
+				} else if (events[i].events & (EPOLLIN | EPOLLHUP)) {
 					// Ready for reading.
-					int fd = events[i].data.fd;
-					fd_status_t status = on_peer_ready_recv(fd);
-					struct epoll_event event = {0};
-					event.data.fd = fd;
-					if (status.want_read) {
-						event.events |= EPOLLIN;
-					}
-					if (status.want_write) {
-						event.events |= EPOLLOUT;
-					}
-					if (event.events == 0) {
-						log_debug("socket %d closing", fd);
-						if (epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
-							log_error("epoll_ctl EPOLL_CTL_DEL");
-							return NULL;
-						}
-						close(fd);
-					} else if (epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &event) < 0) {
-						log_error("epoll_ctl EPOLL_CTL_MOD");
-						return NULL;
-					}
-				} else if (events[i].events & EPOLLOUT) {
-					// Ready for writing.
-					int fd = events[i].data.fd;
-					fd_status_t status = on_peer_ready_send(fd, monitoring);
-					struct epoll_event event = {0};
-					event.data.fd = fd;
-
-					if (status.want_read) {
-						event.events |= EPOLLIN;
-					}
-					if (status.want_write) {
-						event.events |= EPOLLOUT;
-					}
-					if (event.events == 0) {
-						log_debug("socket %d closing", fd);
-						if (epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
-							log_error("epoll_ctl EPOLL_CTL_DEL");
-							return NULL;
-						}
-						close(fd);
-					} else if (epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &event) < 0) {
-						log_error("epoll_ctl EPOLL_CTL_MOD");
-						return NULL;
-					}
+					status = on_peer_ready_recv(peer, monitoring);
+				} else {
+					continue;
+				}
+				struct epoll_event event = {0};
+				event.data.ptr = peer;
+				if (status.want_read) {
+					event.events |= EPOLLIN;
+				}
+				if (status.want_write) {
+					event.events |= EPOLLOUT;
+				}
+				if (event.events == 0) {
+					close_peer(epollfd, &pool, peer);
+				} else if (epoll_ctl(epollfd, EPOLL_CTL_MOD, peer->fd, &event) < 0) {
+					log_error("epoll_ctl EPOLL_CTL_MOD");
+					close_peer(epollfd, &pool, peer);
 				}
 			}
 		}
+		close_idle_peers(epollfd, &pool, monitoring->idle_timeout);
+
 		pthread_mutex_lock(&monitoring->mutex);
 		stop = monitoring->stop;
 		pthread_mutex_unlock(&monitoring->mutex);
 
 	}
+exit:
+	peer_pool_destroy(&pool);
+	free(events);
+	close(epollfd);
 	log_info("Monitoring: Exiting thread");
 
 	return NULL;
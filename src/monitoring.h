@@ -14,6 +14,8 @@
 #include <pthread.h>
 #include <oscillator-disciplining/oscillator-disciplining.h>
 #include "config.h"
+#include "history.h"
+#include "monitoring_shm.h"
 #include "oscillator.h"
 
 enum monitoring_request {
@@ -30,7 +32,12 @@ enum monitoring_request {
 	REQUEST_FAKE_HOLDOVER_STOP,
 	REQUEST_MRO_COARSE_INC,
 	REQUEST_MRO_COARSE_DEC,
-	REQUEST_RESET_UBLOX_SERIAL
+	REQUEST_RESET_UBLOX_SERIAL,
+	REQUEST_HISTORY,
+	REQUEST_GNSS_MESSAGES,
+	REQUEST_GNSS_SIGNALS,
+	REQUEST_CALIBRATION_ABORT,
+	REQUEST_BOOT_TIMELINE
 };
 
 /**
@@ -44,10 +51,26 @@ struct monitoring {
 	struct od_monitoring disciplining;
 	struct oscillator_ctrl ctrl_values;
 	struct oscillator_attributes osc_attributes;
+	/** Calibration progress, pointers must not be used */
+	struct oscillator_calibration calibration;
+	/** Phase error corrected by the quantization error of its pulse, in ns */
+	double phase_error_corrected;
+	/** Wether a quantization error matched the pulse of the phase error */
+	bool qerr_matched;
 	struct gnss_state gnss_info;
 	const char *oscillator_model;
 	struct devices_path devices_path;
+	/** History of monitoring values, fed by main loop */
+	struct history *history;
+	/** Shared memory export of monitoring values, NULL if disabled */
+	struct monitoring_shm *shm;
+	const char *shm_name;
+	uint64_t shm_updates;
 	int sockfd;
+	/** Maximum number of simultaneously connected clients */
+	int max_clients;
+	/** Seconds after which an idle client is disconnected, 0 to disable */
+	int idle_timeout;
 	bool stop;
 	bool disciplining_mode;
 	bool phase_error_supported;
@@ -55,4 +78,5 @@ struct monitoring {
 
 struct monitoring* monitoring_init(const struct config *config, struct devices_path *devices_path);
 void monitoring_stop(struct monitoring *monitoring);
+void monitoring_export(struct monitoring *monitoring);
 #endif // MONITORING_H
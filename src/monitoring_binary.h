@@ -0,0 +1,97 @@
+/**
+ * @file monitoring_binary.h
+ * @brief Binary wire format of the monitoring socket
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Alternative to the json protocol for clients polling monitoring data at
+ * high rate. Protocol is selected per connection by the first request
+ * received: a json object selects json, MONITORING_BIN_MAGIC selects the
+ * binary format for the rest of the connection.
+ *
+ * Messages are fixed layout packed structures, multi-bytes fields are
+ * little endian. Response carries its own length so that a client only
+ * knowing an older version can skip fields appended by newer ones.
+ * Values that are floating point numbers in json are sent as scaled
+ * integers.
+ */
+#ifndef MONITORING_BINARY_H
+#define MONITORING_BINARY_H
+
+#include <stdint.h>
+
+#define MONITORING_BIN_MAGIC "ODMB"
+#define MONITORING_BIN_MAGIC_LEN 4
+#define MONITORING_BIN_VERSION 1
+
+/** Response contains valid disciplining fields */
+#define MONITORING_BIN_FLAG_DISCIPLINING 0x01
+/** Request was an action which has been forwarded to oscillatord */
+#define MONITORING_BIN_FLAG_ACTION 0x02
+/**
+ * Version of request is not supported: request is ignored and only the
+ * header of the response is filled
+ */
+#define MONITORING_BIN_FLAG_BAD_VERSION 0x04
+
+#define MONITORING_BIN_MODEL_LEN 16
+
+/**
+ * @struct monitoring_bin_request
+ * @brief Request sent by a client
+ */
+struct monitoring_bin_request {
+	char magic[MONITORING_BIN_MAGIC_LEN];
+	uint8_t version;
+	uint8_t reserved;
+	/** enum monitoring_request value */
+	uint16_t request;
+} __attribute__((packed));
+
+/**
+ * @struct monitoring_bin_response
+ * @brief Response sent by oscillatord for each request
+ */
+struct monitoring_bin_response {
+	char magic[MONITORING_BIN_MAGIC_LEN];
+	uint8_t version;
+	uint8_t flags;
+	/** Size of the whole response in bytes */
+	uint16_t length;
+	/** Request this is an answer to */
+	uint16_t request;
+
+	/* Clock */
+	uint8_t clock_class;
+	int32_t clock_offset;
+
+	/* Oscillator */
+	char oscillator_model[MONITORING_BIN_MODEL_LEN];
+	int32_t fine_ctrl;
+	int32_t coarse_ctrl;
+	uint8_t lock;
+	/** Temperature in thousandths of degree Celsius */
+	int32_t temperature;
+
+	/* GNSS */
+	uint8_t fix;
+	uint8_t fix_ok;
+	int8_t antenna_power;
+	int8_t antenna_status;
+	int8_t ls_change;
+	int16_t leap_seconds;
+	uint8_t satellites_count;
+	/** Survey in position error in millimeters, -1 if unknown */
+	int32_t survey_in_position_error;
+
+	/* Disciplining, only valid with MONITORING_BIN_FLAG_DISCIPLINING */
+	uint8_t status;
+	uint8_t ready_for_holdover;
+	int32_t current_phase_convergence_count;
+	int32_t valid_phase_convergence_threshold;
+	/** Convergence progress in hundredths of percent */
+	uint16_t convergence_progress;
+} __attribute__((packed));
+
+#endif // MONITORING_BINARY_H
@@ -0,0 +1,92 @@
+/**
+ * @file monitoring_shm.c
+ * @brief Writer of the monitoring shared memory segment
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ */
+#include <sys/stat.h>
+
+#include "log.h"
+#include "monitoring_shm.h"
+
+/**
+ * @brief Create and map the shared memory segment
+ *
+ * Segment is readable by everyone, only oscillatord can write it.
+ *
+ * @param name name of the segment, starting with a '/'
+ * @return mapped segment, NULL on error
+ */
+struct monitoring_shm *monitoring_shm_create(const char *name)
+{
+	struct monitoring_shm *shm;
+	int fd;
+
+	fd = shm_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0) {
+		log_error("Monitoring shm: could not open %s: %s", name, strerror(errno));
+		return NULL;
+	}
+	/* shm_open mode is subject to umask */
+	fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+	if (ftruncate(fd, sizeof(*shm)) < 0) {
+		log_error("Monitoring shm: could not size %s: %s", name, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		log_error("Monitoring shm: could not map %s: %s", name, strerror(errno));
+		return NULL;
+	}
+
+	memset(shm, 0, sizeof(*shm));
+	shm->version = MONITORING_SHM_VERSION;
+	shm->snapshot_size = sizeof(shm->snapshot);
+	/* Readers check magic last written */
+	__atomic_store_n(&shm->magic, MONITORING_SHM_MAGIC, __ATOMIC_RELEASE);
+	log_info("Monitoring shm: exporting monitoring data in %s", name);
+
+	return shm;
+}
+
+/**
+ * @brief Publish a new snapshot
+ *
+ * Only one thread may publish
+ *
+ * @param shm mapped segment
+ * @param snapshot snapshot to copy in the segment
+ */
+void monitoring_shm_publish(struct monitoring_shm *shm,
+	const struct monitoring_shm_snapshot *snapshot)
+{
+	uint32_t seq;
+
+	if (shm == NULL)
+		return;
+
+	seq = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&shm->snapshot, snapshot, sizeof(*snapshot));
+	__atomic_store_n(&shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Unmap and remove the segment
+ *
+ * @param shm mapped segment
+ * @param name name of the segment
+ */
+void monitoring_shm_destroy(struct monitoring_shm *shm, const char *name)
+{
+	if (shm == NULL)
+		return;
+	munmap(shm, sizeof(*shm));
+	shm_unlink(name);
+}
@@ -0,0 +1,144 @@
+/**
+ * @file monitoring_shm.h
+ * @brief Monitoring snapshot exported in POSIX shared memory
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * oscillatord publishes the monitoring values once per main loop iteration
+ * in a shared memory segment, so that local consumers can read them without
+ * any syscall nor load on the monitoring socket.
+ * Segment is protected by a sequence counter: writer makes it odd while
+ * updating the snapshot and even once done. A reader copies the snapshot and
+ * retries if the counter was odd or changed meanwhile.
+ *
+ * This header is self contained so that consumers can use the inline reader:
+ *
+ *	struct monitoring_shm_snapshot snapshot;
+ *	const struct monitoring_shm *shm = monitoring_shm_attach("/oscillatord");
+ *	if (shm != NULL && monitoring_shm_read(shm, &snapshot) == 0)
+ *		printf("phase error %d\n", snapshot.phase_error);
+ */
+#ifndef MONITORING_SHM_H
+#define MONITORING_SHM_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MONITORING_SHM_MAGIC 0x534d444f /* "ODMS" */
+#define MONITORING_SHM_VERSION 1
+#define MONITORING_SHM_READ_RETRIES 100
+
+/**
+ * @struct monitoring_shm_snapshot
+ * @brief Monitoring values at a given time, in host byte order
+ */
+struct monitoring_shm_snapshot {
+	/** Time of the update, in seconds since epoch */
+	int64_t timestamp;
+	/** Number of the update, incremented at each publication */
+	uint64_t update_count;
+
+	/* Clock */
+	int32_t clock_class;
+	int32_t phase_error;
+
+	/* Oscillator */
+	int32_t fine_ctrl;
+	int32_t coarse_ctrl;
+	int32_t locked;
+	double temperature;
+
+	/* Disciplining, only valid if disciplining_valid */
+	int32_t disciplining_valid;
+	int32_t status;
+	int32_t current_phase_convergence_count;
+	int32_t valid_phase_convergence_threshold;
+	double convergence_progress;
+	int32_t ready_for_holdover;
+
+	/* GNSS */
+	int32_t fix;
+	int32_t fix_ok;
+	int32_t antenna_power;
+	int32_t antenna_status;
+	int32_t satellites_count;
+	int32_t leap_seconds;
+	int32_t ls_change;
+	double survey_in_position_error;
+};
+
+/**
+ * @struct monitoring_shm
+ * @brief Layout of the shared memory segment
+ */
+struct monitoring_shm {
+	uint32_t magic;
+	uint32_t version;
+	/** Size of struct monitoring_shm_snapshot */
+	uint32_t snapshot_size;
+	/** Sequence counter, odd while snapshot is being written */
+	uint32_t seq;
+	struct monitoring_shm_snapshot snapshot;
+};
+
+/**
+ * @brief Map an existing segment read only
+ *
+ * @param name name of the segment, as in monitoring-shm config key
+ * @return mapped segment, NULL on error with errno set
+ */
+static inline const struct monitoring_shm *monitoring_shm_attach(const char *name)
+{
+	const struct monitoring_shm *shm;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED)
+		return NULL;
+	if (shm->magic != MONITORING_SHM_MAGIC ||
+		shm->version != MONITORING_SHM_VERSION) {
+		munmap((void *) shm, sizeof(*shm));
+		errno = EPROTO;
+		return NULL;
+	}
+	return shm;
+}
+
+/**
+ * @brief Copy a consistent snapshot out of the segment
+ *
+ * @param shm mapped segment
+ * @param snapshot where snapshot is copied
+ * @return 0 on success, -EAGAIN if writer kept updating the snapshot
+ */
+static inline int monitoring_shm_read(const struct monitoring_shm *shm,
+	struct monitoring_shm_snapshot *snapshot)
+{
+	for (int i = 0; i < MONITORING_SHM_READ_RETRIES; i++) {
+		uint32_t before = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+		if (before & 1)
+			continue;
+		memcpy(snapshot, (const void *) &shm->snapshot, sizeof(*snapshot));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == before)
+			return 0;
+	}
+	return -EAGAIN;
+}
+
+/* Writer side, implemented in oscillatord */
+struct monitoring_shm *monitoring_shm_create(const char *name);
+void monitoring_shm_publish(struct monitoring_shm *shm,
+	const struct monitoring_shm_snapshot *snapshot);
+void monitoring_shm_destroy(struct monitoring_shm *shm, const char *name);
+
+#endif // MONITORING_SHM_H
@@ -85,6 +85,8 @@ enum segstat_t ntp_read(struct shmTime *, struct shm_stat_t *, const bool);
 void ntp_write(volatile struct shmTime *, struct timedelta_t *, int, int);
 
 void ntpshm_context_init(struct gps_context_t *);
+volatile struct shmTime *ntpshm_alloc_unit(struct gps_context_t *, int);
+bool ntpshm_free(struct gps_context_t *, volatile struct shmTime *);
 void ntpshm_session_init(struct gps_device_t *);
 int ntpshm_put(struct gps_device_t *, volatile struct shmTime *, struct timedelta_t *);
 void ntpshm_link_deactivate(struct gps_device_t *);
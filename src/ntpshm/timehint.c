@@ -18,6 +18,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <time.h>        /* for timespec */
 #include <unistd.h>
@@ -163,38 +164,49 @@ void ntpshm_context_init(struct gps_context_t *context)
     memset(context->shmTimeInuse, 0, sizeof(context->shmTimeInuse));
 }
 
+/* allocate a given NTP SHM segment.  return it, or NULL if not attached
+ * or already in use */
+volatile struct shmTime *ntpshm_alloc_unit(struct gps_context_t *context,
+                                           int i)
+{
+    if (i < 0 || i >= NTPSHMSEGS ||
+        context->shmTime[i] == NULL || context->shmTimeInuse[i])
+        return NULL;
+
+    context->shmTimeInuse[i] = true;
+
+    /*
+     * In case this segment gets sent to ntpd before an
+     * ephemeris is available, the LEAP_NOTINSYNC value will
+     * tell ntpd that this source is in a "clock alarm" state
+     * and should be ignored.  The goal is to prevent ntpd
+     * from declaring the GPS a falseticker before it gets
+     * all its marbles together.
+     */
+    memset((void *)context->shmTime[i], 0, sizeof(struct shmTime));
+    context->shmTime[i]->mode = 1;
+    context->shmTime[i]->leap = LEAP_NOTINSYNC;
+    context->shmTime[i]->precision = -20;/* initially 1 micro sec */
+    context->shmTime[i]->nsamples = 3;  /* stages of median filter */
+    log_info("NTP:PPS: using SHM(%d)", i);
+
+    return context->shmTime[i];
+}
+
 /* allocate NTP SHM segment.  return its segment number, or -1 */
 static volatile struct shmTime *ntpshm_alloc(struct gps_context_t *context)
 {
     int i;
     for (i = 0; i < NTPSHMSEGS; i++) {
-        if (context->shmTime[i] != NULL && !context->shmTimeInuse[i]) {
-            context->shmTimeInuse[i] = true;
-
-            /*
-             * In case this segment gets sent to ntpd before an
-             * ephemeris is available, the LEAP_NOTINSYNC value will
-             * tell ntpd that this source is in a "clock alarm" state
-             * and should be ignored.  The goal is to prevent ntpd
-             * from declaring the GPS a falseticker before it gets
-             * all its marbles together.
-             */
-            memset((void *)context->shmTime[i], 0, sizeof(struct shmTime));
-            context->shmTime[i]->mode = 1;
-            context->shmTime[i]->leap = LEAP_NOTINSYNC;
-            context->shmTime[i]->precision = -20;/* initially 1 micro sec */
-            context->shmTime[i]->nsamples = 3;  /* stages of median filter */
-            log_info("NTP:PPS: using SHM(%d)", i);
-
-            return context->shmTime[i];
-        }
+        if (context->shmTime[i] != NULL && !context->shmTimeInuse[i])
+            return ntpshm_alloc_unit(context, i);
     }
 
     return NULL;
 }
 
-static bool ntpshm_free(struct gps_context_t * context,
-                        volatile struct shmTime *s)
+bool ntpshm_free(struct gps_context_t * context,
+                 volatile struct shmTime *s)
 /* free NTP SHM segment */
 {
     int i;
@@ -213,6 +225,9 @@ void ntpshm_session_init(struct gps_device_t *session)
     /* mark NTPD shared memory segments as unused */
     session->shm_clock = NULL;
     session->shm_pps = NULL;
+    session->chronyfd = -1;
+    session->chrony_path = NULL;
+    session->ntpshm_publisher = NULL;
 }
 
 /* put a received fix time into shared memory for NTP */
@@ -262,6 +277,102 @@ struct sock_sample {
     int magic;      /* must be SOCK_MAGIC */
 };
 
+/* connect to the SOCK refclock socket created by chronyd */
+static int chrony_connect(struct gps_device_t *session, bool verbose)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    int fd;
+
+    if (strlen(session->chrony_path) >= sizeof(addr.sun_path)) {
+        if (verbose)
+            log_error("PPS: chrony socket path %s is too long",
+                      session->chrony_path);
+        return -ENAMETOOLONG;
+    }
+    (void)strcpy(addr.sun_path, session->chrony_path);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        log_error("PPS: could not create chrony socket: %s", strerror(errno));
+        return -errno;
+    }
+    /* chronyd creates the socket when it starts, it may not be running yet */
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int ret = -errno;
+
+        if (verbose)
+            log_warn("PPS: could not connect to chrony socket %s: %s",
+                     session->chrony_path, strerror(errno));
+        (void)close(fd);
+        return ret;
+    }
+    log_info("PPS: sending samples to chrony socket %s",
+             session->chrony_path);
+    session->chronyfd = fd;
+    return 0;
+}
+
+/* td is the real time and clock time of the edge */
+/* offset is actual_ts - clock_ts */
+static void chrony_send(struct gps_device_t *session, struct timedelta_t *td)
+{
+    char real_str[TIMESPEC_LEN];
+    char clock_str[TIMESPEC_LEN];
+    struct timespec offset;
+    struct sock_sample sample;
+    struct tm tm;
+    int leap_notify = session->context->leap_notify;
+
+    /* reconnect at each pulse until chronyd is (re)started */
+    if (session->chronyfd < 0 && chrony_connect(session, false) != 0)
+        return;
+
+    /*
+     * insist that leap seconds only happen in june and december,
+     * see ntp_write()
+     */
+    (void)gmtime_r( &(td->real.tv_sec), &tm);
+    if ( 5 != tm.tm_mon && 11 != tm.tm_mon ) {
+        /* Not june, not December, no way */
+        leap_notify = LEAP_NOWARNING;
+    }
+
+    /* chrony expects tv-sec since Jan 1970 */
+    memset(&sample, 0, sizeof(sample));
+    sample.pulse = 0;
+    sample.leap = leap_notify;
+    sample.magic = SOCK_MAGIC;
+    /* chronyd wants a timeval, not a timespec, not to worry, it is
+     * just the top of the second */
+    TSTOTV(&sample.tv, &td->clock);
+    /* calculate the offset as a timespec to not lose precision */
+    TS_SUB( &offset, &td->real, &td->clock);
+    /* if tv_sec greater than 2 then tv_nsec loses precision, but
+     * not a big deal as slewing will be required */
+    sample.offset = TSTONS( &offset );
+
+    log_trace("PPS: chrony_send %s @ %s Offset: %0.9f",
+              timespec_str(&td->real, real_str, sizeof(real_str)),
+              timespec_str(&td->clock, clock_str, sizeof(clock_str)),
+              sample.offset);
+    if (send(session->chronyfd, &sample, sizeof(sample), 0) < 0) {
+        /* chronyd stopped or was restarted, reconnect on next pulse */
+        log_warn("PPS: could not send sample to chrony socket %s: %s",
+                 session->chrony_path, strerror(errno));
+        (void)close(session->chronyfd);
+        session->chronyfd = -1;
+    }
+}
+
+static void chrony_init(struct gps_device_t *session)
+/* for chrony SOCK interface, which allows nSec timekeeping */
+{
+    session->chronyfd = -1;
+    if (session->chrony_path == NULL)
+        return;
+    (void)chrony_connect(session, true);
+}
+
 
 static char *report_hook(volatile struct pps_thread_t *pps_thread,
                                         struct timedelta_t *td)
@@ -291,6 +402,9 @@ static char *report_hook(volatile struct pps_thread_t *pps_thread,
     if (session->shm_pps != NULL)
         (void)ntpshm_put(session, session->shm_pps, td);
 
+    if (session->chrony_path != NULL)
+        chrony_send(session, td);
+
     /* session context might have a hook set, too */
     if (session->context->pps_hook != NULL)
         session->context->pps_hook(session, td);
@@ -307,11 +421,16 @@ void ntpshm_link_deactivate(struct gps_device_t *session)
         (void)ntpshm_free(session->context, session->shm_clock);
         session->shm_clock = NULL;
     }
-    if (session->shm_pps != NULL) {
+    if (session->pps_thread.report_hook != NULL)
         pps_thread_deactivate(&session->pps_thread);
+    if (session->shm_pps != NULL) {
         (void)ntpshm_free(session->context, session->shm_pps);
         session->shm_pps = NULL;
     }
+    if (session->chronyfd >= 0) {
+        (void)close(session->chronyfd);
+        session->chronyfd = -1;
+    }
 }
 
 /* set up ntpshm storage for a session */
@@ -327,7 +446,8 @@ void ntpshm_link_activate(struct gps_device_t *session)
 
         if (session->shm_clock == NULL) {
             log_warn("NTP: ntpshm_alloc() failed");
-            return;
+            if (session->chrony_path == NULL)
+                return;
         }
     }
 
@@ -338,10 +458,17 @@ void ntpshm_link_activate(struct gps_device_t *session)
          * for the 1pps time data and launch a thread to capture the 1pps
          * transitions
          */
-        session->shm_pps = ntpshm_alloc(session->context);
-        if (NULL == session->shm_pps) {
-            log_warn("PPS: ntpshm_alloc(1) failed");
-        } else {
+        /* with a publisher, PPS is written in its configured unit, if any,
+         * through the pps_hook */
+        if (session->ntpshm_publisher == NULL) {
+            session->shm_pps = ntpshm_alloc(session->context);
+            if (NULL == session->shm_pps)
+                log_warn("PPS: ntpshm_alloc(1) failed");
+        }
+        /* samples are pushed to chrony even without SHM segment */
+        chrony_init(session);
+        if (session->shm_pps != NULL || session->chrony_path != NULL ||
+            session->context->pps_hook != NULL) {
             session->pps_thread.report_hook = report_hook;
             pps_thread_activate(&session->pps_thread);
         }
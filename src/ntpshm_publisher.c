@@ -0,0 +1,361 @@
+/**
+ * @file ntpshm_publisher.c
+ * @brief Publisher of time sources in NTP SHM segments
+ * @date 2023-10-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Samples of PPS and GNSS sources are posted by the PPS and GNSS threads and
+ * written by the publisher thread, which also samples the PHC once per
+ * second. Writes use the mode 1 protocol of ntp_write(): readers retry when
+ * count changed while they copied the segment.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/ptp_clock.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "log.h"
+#include "ntpshm_publisher.h"
+
+/* TAI - UTC when GPS time started, GPS - UTC is given by leap seconds */
+#define TAI_UTC_AT_GPS_EPOCH 19
+
+/* Default precisions of sources, log2 of their jitter in seconds */
+#define NTPSHM_PHC_PRECISION -20
+#define NTPSHM_PPS_PRECISION -20
+#define NTPSHM_GNSS_PRECISION -1
+
+static const char *ntpshm_source_names[NTPSHM_SOURCE_NUM] = {
+	[NTPSHM_SOURCE_PHC] = "phc",
+	[NTPSHM_SOURCE_PPS] = "pps",
+	[NTPSHM_SOURCE_GNSS] = "gnss",
+};
+
+static int64_t ptp_clock_time_ns(const struct ptp_clock_time *t)
+{
+	return t->sec * 1000000000LL + t->nsec;
+}
+
+static void ns_to_timespec(int64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / 1000000000LL;
+	ts->tv_nsec = ns % 1000000000LL;
+}
+
+/**
+ * @brief Read PHC and system time
+ *
+ * Among NTPSHM_PHC_SAMPLES readings, keeps the one with the shortest system
+ * time window around the PHC reading, system time being its middle.
+ *
+ * @param publisher
+ * @param td PHC time in real, system time in clock
+ * @return 0 on success, -errno on error
+ */
+static int ntpshm_publisher_read_phc(struct ntpshm_publisher *publisher, struct timedelta_t *td)
+{
+	int64_t best_window = INT64_MAX;
+	int64_t phc = 0;
+	int64_t sys = 0;
+
+	if (publisher->sys_offset_extended) {
+		struct ptp_sys_offset_extended sysoff = { .n_samples = NTPSHM_PHC_SAMPLES };
+
+		if (ioctl(publisher->fd_clock, PTP_SYS_OFFSET_EXTENDED, &sysoff) == 0) {
+			for (unsigned int i = 0; i < sysoff.n_samples; i++) {
+				int64_t before = ptp_clock_time_ns(&sysoff.ts[i][0]);
+				int64_t after = ptp_clock_time_ns(&sysoff.ts[i][2]);
+
+				if (after - before < best_window) {
+					best_window = after - before;
+					phc = ptp_clock_time_ns(&sysoff.ts[i][1]);
+					sys = before + (after - before) / 2;
+				}
+			}
+		} else if (errno == ENOTTY || errno == EOPNOTSUPP) {
+			log_info("NTP publisher: PTP_SYS_OFFSET_EXTENDED not supported, using PTP_SYS_OFFSET");
+			publisher->sys_offset_extended = false;
+		} else {
+			return -errno;
+		}
+	}
+
+	if (!publisher->sys_offset_extended) {
+		/* System and PHC times alternate, starting and ending with system time */
+		struct ptp_sys_offset sysoff = { .n_samples = NTPSHM_PHC_SAMPLES };
+
+		if (ioctl(publisher->fd_clock, PTP_SYS_OFFSET, &sysoff) < 0)
+			return -errno;
+		for (unsigned int i = 0; i < sysoff.n_samples; i++) {
+			int64_t before = ptp_clock_time_ns(&sysoff.ts[2 * i]);
+			int64_t after = ptp_clock_time_ns(&sysoff.ts[2 * i + 2]);
+
+			if (after - before < best_window) {
+				best_window = after - before;
+				phc = ptp_clock_time_ns(&sysoff.ts[2 * i + 1]);
+				sys = before + (after - before) / 2;
+			}
+		}
+	}
+
+	ns_to_timespec(phc, &td->real);
+	ns_to_timespec(sys, &td->clock);
+	return 0;
+}
+
+/**
+ * @brief Sample PHC, converting its TAI time to UTC
+ *
+ * @param publisher
+ * @param td UTC time of the PHC in real, system time in clock
+ * @param leap_notify leap second notification
+ * @return 0 on success, -EAGAIN if UTC offset is not known yet, -errno on error
+ */
+static int ntpshm_publisher_sample_phc(struct ntpshm_publisher *publisher, struct timedelta_t *td,
+	int *leap_notify)
+{
+	struct gps_context_t *context = publisher->session->context;
+	int ret;
+
+	if (!context->lsset)
+		return -EAGAIN;
+
+	ret = ntpshm_publisher_read_phc(publisher, td);
+	if (ret != 0)
+		return ret;
+	td->real.tv_sec -= TAI_UTC_AT_GPS_EPOCH + context->leap_seconds;
+	*leap_notify = context->leap_notify;
+	return 0;
+}
+
+static void *ntpshm_publisher_thread(void *p_data)
+{
+	struct ntpshm_publisher *publisher = p_data;
+	struct ntpshm_unit *phc = &publisher->units[NTPSHM_SOURCE_PHC];
+	struct ntpshm_unit samples[NTPSHM_SOURCE_NUM];
+	struct timespec deadline;
+	int last_phc_error = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	pthread_mutex_lock(&publisher->mutex);
+	while (!publisher->stop) {
+		struct timespec now;
+		int ret;
+
+		/* Take posted samples and write them without holding the lock */
+		memcpy(samples, publisher->units, sizeof(samples));
+		for (int i = 0; i < NTPSHM_SOURCE_NUM; i++)
+			publisher->units[i].pending = false;
+		pthread_mutex_unlock(&publisher->mutex);
+
+		for (int i = 0; i < NTPSHM_SOURCE_NUM; i++) {
+			if (samples[i].shm != NULL && samples[i].pending)
+				ntp_write(samples[i].shm, &samples[i].td, samples[i].precision,
+					samples[i].leap_notify);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (phc->shm != NULL &&
+			(now.tv_sec > deadline.tv_sec ||
+			 (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))) {
+			struct timedelta_t td;
+			int leap_notify;
+
+			ret = ntpshm_publisher_sample_phc(publisher, &td, &leap_notify);
+			if (ret == 0)
+				ntp_write(phc->shm, &td, phc->precision, leap_notify);
+			else if (ret != -EAGAIN && ret != last_phc_error)
+				log_warn("NTP publisher: could not read PHC: %s", strerror(-ret));
+			last_phc_error = ret;
+			deadline.tv_sec++;
+			if (deadline.tv_sec < now.tv_sec)
+				deadline = now;
+		}
+
+		pthread_mutex_lock(&publisher->mutex);
+		while (!publisher->stop) {
+			bool pending = false;
+
+			for (int i = 0; i < NTPSHM_SOURCE_NUM; i++)
+				pending |= publisher->units[i].pending;
+			if (pending)
+				break;
+			if (phc->shm == NULL)
+				pthread_cond_wait(&publisher->cond, &publisher->mutex);
+			else if (pthread_cond_timedwait(&publisher->cond, &publisher->mutex,
+					&deadline) == ETIMEDOUT)
+				break;
+		}
+	}
+	pthread_mutex_unlock(&publisher->mutex);
+
+	return NULL;
+}
+
+/**
+ * @brief PPS thread hook, posting kernel PPS samples of the PHC
+ */
+static void ntpshm_publisher_pps_hook(struct gps_device_t *session, struct timedelta_t *td)
+{
+	struct ntpshm_publisher *publisher = __atomic_load_n(&session->ntpshm_publisher,
+		__ATOMIC_ACQUIRE);
+
+	if (publisher != NULL)
+		ntpshm_publisher_post(publisher, NTPSHM_SOURCE_PPS, td,
+			session->context->leap_notify);
+}
+
+/**
+ * @brief Allocate units given in configuration and start publisher thread
+ *
+ * Must be called after ntpshm_context_init and before ntpshm_link_activate,
+ * which does not allocate its first free segment to the PPS source anymore
+ * when a publisher is used.
+ *
+ * @param config configuration
+ * @param session session of the card's receiver
+ * @param fd_clock PHC handler
+ * @return publisher, NULL if no unit is configured or on error
+ */
+struct ntpshm_publisher *ntpshm_publisher_init(const struct config *config,
+	struct gps_device_t *session, int fd_clock)
+{
+	const int precisions[NTPSHM_SOURCE_NUM] = {
+		[NTPSHM_SOURCE_PHC] = NTPSHM_PHC_PRECISION,
+		[NTPSHM_SOURCE_PPS] = NTPSHM_PPS_PRECISION,
+		[NTPSHM_SOURCE_GNSS] = NTPSHM_GNSS_PRECISION,
+	};
+	struct ntpshm_publisher *publisher;
+	pthread_condattr_t attr;
+	int count = 0;
+	int ret;
+
+	publisher = calloc(1, sizeof(*publisher));
+	if (publisher == NULL) {
+		log_error("NTP publisher: could not allocate memory");
+		return NULL;
+	}
+	publisher->fd_clock = fd_clock;
+	publisher->sys_offset_extended = true;
+	publisher->session = session;
+
+	for (int i = 0; i < NTPSHM_SOURCE_NUM; i++) {
+		struct ntpshm_unit *unit = &publisher->units[i];
+		char key[32];
+		long value;
+
+		snprintf(key, sizeof(key), "ntpshm-%s-unit", ntpshm_source_names[i]);
+		/* Source is disabled when not set, checked first as config_get_unsigned_number
+		 * returns a stale errno instead of -ESRCH for missing keys */
+		if (config_get(config, key) == NULL)
+			continue;
+		value = config_get_unsigned_number(config, key);
+		if (value < 0 || value >= NTPSHMSEGS) {
+			log_error("NTP publisher: %s must be between 0 and %d", key, NTPSHMSEGS - 1);
+			continue;
+		}
+		unit->shm = ntpshm_alloc_unit(session->context, value);
+		if (unit->shm == NULL) {
+			log_error("NTP publisher: could not use SHM(%ld) for %s source",
+				value, ntpshm_source_names[i]);
+			continue;
+		}
+		unit->unit = value;
+		unit->precision = precisions[i];
+		log_info("NTP publisher: %s source in SHM(%ld)", ntpshm_source_names[i], value);
+		count++;
+	}
+	if (count == 0)
+		goto free_units;
+
+	pthread_mutex_init(&publisher->mutex, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&publisher->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	ret = pthread_create(&publisher->thread, NULL, ntpshm_publisher_thread, publisher);
+	if (ret != 0) {
+		log_error("NTP publisher: could not create thread: %s", strerror(ret));
+		pthread_cond_destroy(&publisher->cond);
+		pthread_mutex_destroy(&publisher->mutex);
+		goto free_units;
+	}
+
+	if (publisher->units[NTPSHM_SOURCE_PPS].shm != NULL)
+		session->context->pps_hook = ntpshm_publisher_pps_hook;
+	__atomic_store_n(&session->ntpshm_publisher, publisher, __ATOMIC_RELEASE);
+
+	return publisher;
+
+free_units:
+	for (int i = 0; i < NTPSHM_SOURCE_NUM; i++) {
+		if (publisher->units[i].shm != NULL)
+			(void)ntpshm_free(session->context, publisher->units[i].shm);
+	}
+	free(publisher);
+	return NULL;
+}
+
+/**
+ * @brief Post a sample of a source, written by the publisher thread
+ *
+ * Sample is dropped if source has no unit. A sample not written yet is
+ * replaced.
+ *
+ * @param publisher
+ * @param source
+ * @param td real time of the source and system time
+ * @param leap_notify leap second notification
+ */
+void ntpshm_publisher_post(struct ntpshm_publisher *publisher, enum ntpshm_source source,
+	const struct timedelta_t *td, int leap_notify)
+{
+	struct ntpshm_unit *unit = &publisher->units[source];
+
+	if (unit->shm == NULL)
+		return;
+
+	pthread_mutex_lock(&publisher->mutex);
+	unit->td = *td;
+	unit->leap_notify = leap_notify;
+	unit->pending = true;
+	pthread_cond_signal(&publisher->cond);
+	pthread_mutex_unlock(&publisher->mutex);
+}
+
+/**
+ * @brief Stop publisher thread and release its units
+ *
+ * @param publisher
+ */
+void ntpshm_publisher_stop(struct ntpshm_publisher *publisher)
+{
+	struct gps_device_t *session;
+
+	if (publisher == NULL)
+		return;
+	session = publisher->session;
+
+	__atomic_store_n(&session->ntpshm_publisher, NULL, __ATOMIC_RELEASE);
+	if (session->context->pps_hook == ntpshm_publisher_pps_hook)
+		session->context->pps_hook = NULL;
+
+	pthread_mutex_lock(&publisher->mutex);
+	publisher->stop = true;
+	pthread_cond_signal(&publisher->cond);
+	pthread_mutex_unlock(&publisher->mutex);
+	pthread_join(publisher->thread, NULL);
+
+	for (int i = 0; i < NTPSHM_SOURCE_NUM; i++) {
+		if (publisher->units[i].shm != NULL)
+			(void)ntpshm_free(session->context, publisher->units[i].shm);
+	}
+	pthread_cond_destroy(&publisher->cond);
+	pthread_mutex_destroy(&publisher->mutex);
+	free(publisher);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file ntpshm_publisher.h
+ * @brief Publisher of time sources in NTP SHM segments
+ * @date 2023-10-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Each time source of the card can be published in its own NTP SHM unit, so
+ * that chrony or ntpd can compare and combine them:
+ * - PHC: PHC time compared to system time with PTP_SYS_OFFSET_EXTENDED, once
+ *   per second,
+ * - PPS: kernel PPS events of the PHC, from the PPS thread,
+ * - GNSS: time of the navigation solution, when received on the serial port.
+ * Units are given by ntpshm-phc-unit, ntpshm-pps-unit and ntpshm-gnss-unit
+ * config keys, so that several instances of oscillatord, one per card, do not
+ * share units. Producers only post samples, a single thread writes them in
+ * the segments.
+ */
+#ifndef OSCILLATORD_NTPSHM_PUBLISHER_H
+#define OSCILLATORD_NTPSHM_PUBLISHER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "gnss.h"
+#include "ntpshm/ntpshm.h"
+
+/** Number of PHC and system time triplets read per PHC sample */
+#define NTPSHM_PHC_SAMPLES 5
+
+enum ntpshm_source {
+	NTPSHM_SOURCE_PHC,
+	NTPSHM_SOURCE_PPS,
+	NTPSHM_SOURCE_GNSS,
+	NTPSHM_SOURCE_NUM
+};
+
+/**
+ * @struct ntpshm_unit
+ * @brief NTP SHM unit of a source and its last sample not written yet
+ */
+struct ntpshm_unit {
+	volatile struct shmTime *shm;
+	int unit;
+	/** log2 of the source jitter in seconds */
+	int precision;
+	bool pending;
+	struct timedelta_t td;
+	int leap_notify;
+};
+
+/**
+ * @struct ntpshm_publisher
+ * @brief Publisher thread and units of the sources
+ */
+struct ntpshm_publisher {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool stop;
+	/** PHC handler, used for PHC unit */
+	int fd_clock;
+	/** Whether PTP_SYS_OFFSET_EXTENDED is supported by the PHC driver */
+	bool sys_offset_extended;
+	/** Session of the card's receiver, giving leap seconds data */
+	struct gps_device_t *session;
+	struct ntpshm_unit units[NTPSHM_SOURCE_NUM];
+};
+
+struct ntpshm_publisher *ntpshm_publisher_init(const struct config *config,
+	struct gps_device_t *session, int fd_clock);
+void ntpshm_publisher_post(struct ntpshm_publisher *publisher, enum ntpshm_source source,
+	const struct timedelta_t *td, int leap_notify);
+void ntpshm_publisher_stop(struct ntpshm_publisher *publisher);
+
+#endif /* OSCILLATORD_NTPSHM_PUBLISHER_H */
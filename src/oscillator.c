@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <stdlib.h>
 
 #include "log.h"
 #include "oscillator.h"
@@ -62,23 +63,149 @@ int oscillator_apply_output(struct oscillator *oscillator, struct od_output *out
 	return oscillator->class->apply_output(oscillator, output);
 }
 
-struct calibration_results * oscillator_calibrate(
-	struct oscillator *oscillator,
-	struct phasemeter *phasemeter,
-	struct gnss *gnss,
-	struct calibration_parameters * calib_params,
-	int phase_sign)
+/**
+ * @brief Start a calibration, measured by following calls to oscillator_calibrate
+ *
+ * @param oscillator
+ * @param calibration calibration state, owned by main loop
+ * @param calib_params control points to measure, given by the disciplining algorithm
+ * @param settings how control points are measured, NULL for default
+ * @return 0 on success, negative error code otherwise
+ */
+int oscillator_calibration_start(struct oscillator *oscillator,
+	struct oscillator_calibration *calibration,
+	struct calibration_parameters *calib_params,
+	const struct calibration_settings *settings)
 {
-	if (oscillator == NULL || calib_params == NULL) {
-		log_error("oscillator_calibrate: one input is NULL");
-		return NULL;
+	struct calibration_results *results;
+	struct oscillator_ctrl ctrl;
+
+	if (oscillator == NULL || calibration == NULL || calib_params == NULL) {
+		log_error("oscillator_calibration_start: one input is NULL");
+		return -EINVAL;
 	}
 	if (oscillator->class->calibrate == NULL) {
-		log_error("oscillator_calibrate: calibrate function is null in class !");
-		return NULL;
+		log_error("oscillator_calibration_start: calibrate function is null in class !");
+		return -ENOSYS;
 	}
 
-	return oscillator->class->calibrate(oscillator, phasemeter, gnss, calib_params, phase_sign);
+	results = malloc(sizeof(*results));
+	if (results == NULL) {
+		log_error("Could not allocate memory to create calibration_results");
+		return -ENOMEM;
+	}
+	results->length = calib_params->length;
+	results->nb_calibration = calib_params->nb_calibration;
+	results->measures = malloc(results->length * results->nb_calibration * sizeof(*results->measures));
+	if (results->measures == NULL) {
+		log_error("Could not allocate memory to create calibration measures");
+		free(results);
+		return -ENOMEM;
+	}
+
+	*calibration = (struct oscillator_calibration) {
+		.state = CALIBRATION_APPLY,
+		.params = calib_params,
+		.results = results,
+		.points = calib_params->length,
+		.measures = calib_params->nb_calibration,
+	};
+	if (settings != NULL)
+		calibration->settings = *settings;
+	if (oscillator_get_ctrl(oscillator, &ctrl) == 0)
+		calibration->fine_ctrl_before = ctrl.fine_ctrl;
+	log_info("Starting measure for calibration, %d control points", calibration->points);
+
+	return 0;
+}
+
+bool oscillator_calibration_running(const struct oscillator_calibration *calibration)
+{
+	return calibration->state == CALIBRATION_APPLY ||
+		calibration->state == CALIBRATION_SETTLING ||
+		calibration->state == CALIBRATION_MEASURING;
+}
+
+/**
+ * @brief Make calibration progress with the phase error of current main loop iteration
+ *
+ * @param oscillator
+ * @param calibration calibration started by oscillator_calibration_start
+ * @param sample phase error measured by main loop
+ * @return new state of the calibration, negative error code on invalid input
+ */
+int oscillator_calibrate(struct oscillator *oscillator,
+	struct oscillator_calibration *calibration,
+	const struct calibration_sample *sample)
+{
+	if (oscillator == NULL || calibration == NULL || sample == NULL)
+		return -EINVAL;
+	if (!oscillator_calibration_running(calibration))
+		return calibration->state;
+
+	return oscillator->class->calibrate(oscillator, calibration, sample);
+}
+
+/**
+ * @brief Abort a running calibration and restore fine control it started from
+ *
+ * @param oscillator
+ * @param calibration
+ */
+void oscillator_calibration_abort(struct oscillator *oscillator,
+	struct oscillator_calibration *calibration)
+{
+	struct od_output restore = {
+		.action = ADJUST_FINE,
+		.setpoint = calibration->fine_ctrl_before,
+	};
+
+	if (!oscillator_calibration_running(calibration))
+		return;
+
+	log_warn("Aborting calibration at control point %d/%d, restoring fine control %u",
+		calibration->point + 1, calibration->points, restore.setpoint);
+	if (oscillator_apply_output(oscillator, &restore) < 0)
+		log_error("Could not restore fine control");
+	oscillator_calibration_release(calibration);
+	calibration->state = CALIBRATION_ABORTED;
+}
+
+/**
+ * @brief Free results of a calibration that will not be passed to od_calibrate
+ *
+ * Calibration parameters are owned by the disciplining algorithm.
+ *
+ * @param calibration
+ */
+void oscillator_calibration_release(struct oscillator_calibration *calibration)
+{
+	if (calibration->results != NULL) {
+		free(calibration->results->measures);
+		free(calibration->results);
+	}
+	calibration->results = NULL;
+	calibration->params = NULL;
+}
+
+const char *cstring_from_calibration_state(enum calibration_state state)
+{
+	switch (state) {
+	case CALIBRATION_IDLE:
+		return "idle";
+	case CALIBRATION_APPLY:
+	case CALIBRATION_SETTLING:
+		return "settling";
+	case CALIBRATION_MEASURING:
+		return "measuring";
+	case CALIBRATION_DONE:
+		return "done";
+	case CALIBRATION_FAILED:
+		return "failed";
+	case CALIBRATION_ABORTED:
+		return "aborted";
+	}
+	return "unknown";
 }
 
 int oscillator_get_phase_error(struct oscillator *oscillator, int64_t *phase_error)
@@ -23,6 +23,8 @@
 struct oscillator;
 struct oscillator_ctrl;
 struct oscillator_attributes;
+struct oscillator_calibration;
+struct calibration_sample;
 
 typedef struct oscillator *(*oscillator_new_cb)(struct devices_path *devices_path);
 typedef int (*oscillator_get_ctrl_cb)(struct oscillator *oscillator,
@@ -33,9 +35,8 @@ typedef int (*oscillator_parse_attributes_cb)(struct oscillator *oscillator,
 typedef int (*oscillator_apply_output_cb)(struct oscillator *oscillator,
 		struct od_output *output);
 typedef void (*oscillator_destroy_cb)(struct oscillator **oscillator);
-typedef struct calibration_results* (*oscillator_calibrate_cb)(struct oscillator *oscillator,
-		struct phasemeter *phasemeter, struct gnss *gnss, struct calibration_parameters *calib_params,
-		int phase_sign);
+typedef int (*oscillator_calibrate_cb)(struct oscillator *oscillator,
+		struct oscillator_calibration *calibration, const struct calibration_sample *sample);
 typedef int (*oscillator_get_phase_error_cb)(struct oscillator *oscillator,
 		int64_t *phase_error);
 typedef int (*oscillator_get_disciplining_status_cb)(struct oscillator *oscillator, void *data);
@@ -80,6 +81,91 @@ struct oscillator_attributes {
 	bool locked;
 };
 
+enum calibration_state {
+	CALIBRATION_IDLE,
+	/** Control point is applied at next step */
+	CALIBRATION_APPLY,
+	/** Waiting for the oscillator to settle on control point */
+	CALIBRATION_SETTLING,
+	/** Collecting phase error measures at control point */
+	CALIBRATION_MEASURING,
+	/** All measures collected, results are ready for od_calibrate */
+	CALIBRATION_DONE,
+	CALIBRATION_FAILED,
+	/** Aborted from monitoring, fine control has been restored */
+	CALIBRATION_ABORTED,
+};
+
+/**
+ * @struct calibration_sample
+ * @brief Phase error measured by main loop, fed to calibration
+ */
+struct calibration_sample {
+	int phasemeter_status;
+	/** Phase error in ns, as given by the phasemeter */
+	int64_t phase_error;
+	/** Quantization error of the pulse in ps, only valid if qerr_matched */
+	int32_t qErr;
+	bool qerr_matched;
+};
+
+/**
+ * @struct calibration_settings
+ * @brief How control points are measured
+ */
+struct calibration_settings {
+	/** Measure every pulse and stop each point once drift is known within tolerance */
+	bool adaptive;
+	/** Half width of the 95% confidence interval of the drift to reach, in ps/s */
+	int drift_tolerance_ps;
+	/** Maximum measures per control point in adaptive mode, 0 for default */
+	int max_measures;
+};
+
+/**
+ * @struct calibration_fit
+ * @brief Running sums of the least squares fit of phase error over time
+ *
+ * Times are in seconds since first measure of the control point, phase
+ * errors in ns relative to the first one, to keep sums small.
+ */
+struct calibration_fit {
+	int n;
+	double y0;
+	double sum_t;
+	double sum_y;
+	double sum_tt;
+	double sum_ty;
+	double sum_yy;
+};
+
+/**
+ * @struct oscillator_calibration
+ * @brief Calibration progressing by one step per main loop iteration
+ *
+ * Counters may be copied for monitoring, pointers are owned by main loop.
+ */
+struct oscillator_calibration {
+	enum calibration_state state;
+	struct calibration_parameters *params;
+	struct calibration_results *results;
+	/** Index of the control point measured and number of control points */
+	int point;
+	int points;
+	/** Measures done at current control point and measures per point */
+	int measure;
+	int measures;
+	/** Main loop iterations between two measures */
+	int period;
+	/** Main loop iterations left before next measure, or settling */
+	int wait;
+	/** Fine control before calibration, restored on abort */
+	uint32_t fine_ctrl_before;
+	struct calibration_settings settings;
+	/** Fit of current control point, adaptive mode only */
+	struct calibration_fit fit;
+};
+
 int oscillator_get_phase_error(struct oscillator *oscillator, int64_t *phase_error);
 int oscillator_set_dac_min(struct oscillator *oscillator, uint32_t dac_min);
 int oscillator_set_dac_max(struct oscillator *oscillator, uint32_t dac_max);
@@ -89,11 +175,17 @@ int oscillator_parse_attributes(struct oscillator *oscillator, struct oscillator
 int oscillator_apply_output(struct oscillator *oscillator, struct od_output *output);
 int oscillator_get_disciplining_status(struct oscillator *oscillator, void *data);
 int oscillator_push_gnss_info(struct oscillator *oscillator, bool fixOk, const struct timespec *last_fix_utc_time);
-struct calibration_results * oscillator_calibrate(
-	struct oscillator *oscillator,
-	struct phasemeter *phasemeter,
-	struct gnss *gnss,
-	struct calibration_parameters * calib_params,
-	int phase_sign);
+int oscillator_calibration_start(struct oscillator *oscillator,
+	struct oscillator_calibration *calibration,
+	struct calibration_parameters *calib_params,
+	const struct calibration_settings *settings);
+bool oscillator_calibration_running(const struct oscillator_calibration *calibration);
+int oscillator_calibrate(struct oscillator *oscillator,
+	struct oscillator_calibration *calibration,
+	const struct calibration_sample *sample);
+void oscillator_calibration_abort(struct oscillator *oscillator,
+	struct oscillator_calibration *calibration);
+void oscillator_calibration_release(struct oscillator_calibration *calibration);
+const char *cstring_from_calibration_state(enum calibration_state state);
 
 #endif /* SRC_OSCILLATOR_H_ */
@@ -33,13 +33,17 @@
 #include <oscillator-disciplining/oscillator-disciplining.h>
 #include <linux/ptp_clock.h>
 
+#include "boot_timeline.h"
 #include "config.h"
+#include "control_loop.h"
 #include "eeprom_config.h"
 #include "gnss.h"
+#include "gnss_selector.h"
 #include "log.h"
 #include "monitoring.h"
 #include "ntpshm/ntpshm.h"
 #include "ntpshm/ppsthread.h"
+#include "ntpshm_publisher.h"
 #include "oscillator.h"
 #include "oscillator_factory.h"
 #include "phasemeter.h"
@@ -48,7 +52,6 @@
 #define UPDATE_DISCIPLINING_PARAMETERS_SEC 3600
 
 static struct gps_context_t context;
-struct od *od = NULL;
 struct oscillator *oscillator = NULL;
 struct devices_path devices_path = { 0 };
 pthread_t save_dsc_params_thread;
@@ -143,23 +146,82 @@ static int enable_pps(int fd, bool enable)
 	return 0;
 }
 
-static void prepare_minipod_config(struct minipod_config* minipod_config, struct config * config)
+/**
+ * @struct init_step
+ * @brief Device bring-up step, run in its own thread at startup
+ */
+struct init_step {
+	const char *name;
+	int (*run)(void *data);
+	void *data;
+	pthread_t thread;
+	bool started;
+	/** Result of run, 0 on success, negative error code otherwise */
+	int ret;
+	struct timespec start;
+	struct timespec end;
+};
+
+static double init_step_duration(const struct init_step *step)
+{
+	return (step->end.tv_sec - step->start.tv_sec) +
+		(step->end.tv_nsec - step->start.tv_nsec) / 1e9;
+}
+
+static void *init_step_thread(void *p_data)
+{
+	struct init_step *step = p_data;
+
+	clock_gettime(CLOCK_MONOTONIC, &step->start);
+	step->ret = step->run(step->data);
+	clock_gettime(CLOCK_MONOTONIC, &step->end);
+	log_info("Startup: %s %s in %.3fs", step->name, step->ret == 0 ? "ready" : "failed",
+		init_step_duration(step));
+	return NULL;
+}
+
+/**
+ * @brief Start step in its own thread, it is run by caller if thread cannot be created
+ */
+static void init_step_start(struct init_step *step)
 {
-	minipod_config->calibrate_first = config_get_bool_default(config, "calibrate_first", false);
-	minipod_config->debug = config_get_unsigned_number(config, "debug");
-	minipod_config->fine_stop_tolerance = config_get_unsigned_number(config, "fine_stop_tolerance");
-	minipod_config->max_allowed_coarse = config_get_unsigned_number(config, "max_allowed_coarse");
-	minipod_config->nb_calibration = config_get_unsigned_number(config, "nb_calibration");
-	minipod_config->phase_jump_threshold_ns = config_get_unsigned_number(config, "phase_jump_threshold_ns");
-	minipod_config->phase_resolution_ns = config_get_unsigned_number(config, "phase_resolution_ns");
-	minipod_config->reactivity_max = config_get_unsigned_number(config, "reactivity_max");
-	minipod_config->reactivity_min = config_get_unsigned_number(config, "reactivity_min");
-	minipod_config->reactivity_power = config_get_unsigned_number(config, "reactivity_power");
-	minipod_config->ref_fluctuations_ns = config_get_unsigned_number(config, "ref_fluctuations_ns");
-	minipod_config->oscillator_factory_settings = config_get_bool_default(config, "oscillator_factory_settings", true);
-	minipod_config->learn_temperature_table = config_get_bool_default(config, "learn_temperature_table", false);
-	minipod_config->use_temperature_table = config_get_bool_default(config, "use_temperature_table", false);
-	minipod_config->fine_table_output_path = config_get_default(config, "fine_table_output_path", "/tmp/");
+	if (pthread_create(&step->thread, NULL, init_step_thread, step) == 0) {
+		step->started = true;
+		return;
+	}
+	log_warn("Startup: could not create thread for %s, running it now", step->name);
+	init_step_thread(step);
+}
+
+static int init_step_join(struct init_step *step)
+{
+	if (step->started) {
+		pthread_join(step->thread, NULL);
+		step->started = false;
+	}
+	return step->ret;
+}
+
+static int init_oscillator(void *data)
+{
+	struct config *config = data;
+
+	oscillator = oscillator_factory_new(config, &devices_path);
+	if (oscillator == NULL)
+		return errno != 0 ? -errno : -ENODEV;
+	return 0;
+}
+
+static int init_disciplining_parameters(void *data)
+{
+	struct disciplining_parameters *dsc_params = data;
+
+	/* Get disciplining parameters files exposed by driver */
+	return read_disciplining_parameters_from_eeprom(
+		devices_path.disciplining_config_path,
+		devices_path.temperature_table_path,
+		dsc_params
+	);
 }
 
 static int get_devices_path_from_sysfs(
@@ -208,6 +270,96 @@ static int get_devices_path_from_sysfs(
 	return 0;
 }
 
+/**
+ * @struct control_loop_devices
+ * @brief Devices of the card the control loop runs on
+ */
+struct control_loop_devices {
+	struct phasemeter *phasemeter;
+	/** Active receiver, updated by GNSS selector */
+	struct gnss *gnss;
+	int fd_clock;
+	struct config *config;
+	const char *config_path;
+	/** NULL if monitoring is disabled */
+	struct monitoring *monitoring;
+};
+
+static int devices_get_phase_error(void *data, int64_t *phase_error, int64_t *pps_second)
+{
+	struct control_loop_devices *devices = data;
+
+	return get_phase_error_sample(devices->phasemeter, phase_error, pps_second);
+}
+
+static int devices_get_gnss_epoch(void *data, bool *valid, bool *survey_completed)
+{
+	struct control_loop_devices *devices = data;
+
+	return gnss_get_epoch_data(devices->gnss, valid, survey_completed, NULL);
+}
+
+static int devices_get_gnss_qerr(void *data, int64_t pps_second, int32_t *qErr)
+{
+	struct control_loop_devices *devices = data;
+
+	return gnss_get_qerr(devices->gnss, pps_second, qErr);
+}
+
+static int devices_apply_phase_offset(void *data, int64_t phase_offset)
+{
+	struct control_loop_devices *devices = data;
+
+	return apply_phase_offset(devices->fd_clock, devices_path.ptp_path, phase_offset);
+}
+
+static int devices_save_disciplining_parameters(void *data, struct disciplining_parameters *dsc_params)
+{
+	struct control_loop_devices *devices = data;
+	int ret;
+
+	dsc_params->dsc_config.calibration_date = time(NULL);
+
+	ret = write_disciplining_parameters_in_eeprom(
+		devices_path.disciplining_config_path,
+		devices_path.temperature_table_path,
+		dsc_params
+	);
+	if (ret < 0) {
+		log_error("Error saving data to EEPROM");
+	} else {
+		log_info("Saved disciplining parameters into EEPROM");
+	}
+
+	/* Disable calibrate first to prevent a new calibration when rebooting */
+	config_set(devices->config, "calibrate_first", "false");
+	if (config_save(devices->config, devices->config_path) != 0) {
+		log_warn("Could not disable calibration at boot in config at %s", devices->config_path);
+		log_warn("If you restart oscillatord calibration will be done again !");
+	}
+	return ret;
+}
+
+static void devices_calibration_requested(void *data, const struct od_monitoring *disciplining)
+{
+	struct control_loop_devices *devices = data;
+
+	if (devices->monitoring == NULL)
+		return;
+	/* Clients see the calibration request before the first measure */
+	pthread_mutex_lock(&devices->monitoring->mutex);
+	devices->monitoring->disciplining = *disciplining;
+	pthread_mutex_unlock(&devices->monitoring->mutex);
+}
+
+static const struct control_loop_ops devices_ops = {
+	.get_phase_error = devices_get_phase_error,
+	.get_gnss_epoch = devices_get_gnss_epoch,
+	.get_gnss_qerr = devices_get_gnss_qerr,
+	.apply_phase_offset = devices_apply_phase_offset,
+	.save_disciplining_parameters = devices_save_disciplining_parameters,
+	.calibration_requested = devices_calibration_requested,
+};
 
 /**
  * @brief Main program function
@@ -222,29 +374,41 @@ int main(int argc, char *argv[])
 	struct phasemeter *phasemeter = NULL;
 	struct oscillator_ctrl ctrl_values;
 	struct gnss *gnss;
+	struct gnss_selector *gnss_selector;
+	struct ntpshm_publisher *ntpshm_publisher = NULL;
+	struct control_loop control_loop = { .calibration = { .state = CALIBRATION_IDLE } };
+	struct control_loop_devices devices = { .fd_clock = -1 };
 	struct monitoring *monitoring = NULL;
-	struct od_input input = {0};
-	struct od_output output = {0};
-	struct minipod_config minipod_config = {0};
 	struct disciplining_parameters dsc_params = {0};
+	struct init_step oscillator_step = {
+		.name = "oscillator",
+		.run = init_oscillator,
+		.data = &config,
+	};
+	struct init_step eeprom_step = {
+		.name = "EEPROM",
+		.run = init_disciplining_parameters,
+		.data = &dsc_params,
+	};
+	struct timespec startup, gnss_start, now;
+	struct od_monitoring od_status;
 	const char *path;
-	char err_msg[OD_ERR_MSG_LEN];
 	struct oscillator_attributes osc_attr = { 0 };
 	int64_t phase_error;
+	double phase_error_corrected = 0.0;
+	bool qerr_matched = false;
 	int phasemeter_status;
 	int ret;
 	int sign = 0;
 	int log_level;
 	bool disciplining_mode;
 	bool monitoring_mode;
-	bool opposite_phase_error;
 	bool phase_error_supported = false;
-	bool ignore_next_irq = false;
-	bool fake_holdover_activated = false;
 	__attribute__((cleanup(fd_cleanup))) int fd_clock = -1;
 	volatile struct pps_thread_t * pps_thread = NULL;
 	time_t start_save_epprom_parameters, end_save_eeprom_parameters;
 
+	boot_timeline_start();
 	signal(SIGINT, signal_handler);
 	signal(SIGTERM, signal_handler);
 
@@ -258,6 +422,7 @@ int main(int argc, char *argv[])
 		error(EXIT_FAILURE, -ret, "config_init(%s)", path);
 		return -EINVAL;
 	}
+	boot_timeline_mark(BOOT_CONFIG_PARSED);
 
 	/* Get disciplining and monitoring values from config
 	 * to know how oscillatord should behave
@@ -291,23 +456,15 @@ int main(int argc, char *argv[])
 		log_info("Starting monitoring socket");
 	}
 
-	/* Create oscillator object */
-	oscillator = oscillator_factory_new(&config, &devices_path);
-	if (oscillator == NULL) {
-		error(EXIT_FAILURE, errno, "oscillator_factory_new");
-		return -EINVAL;
-	}
-	log_info("oscillator model %s", oscillator->class->name);
-
-	/* Handle phase error */
-	if (monitoring_mode) {
-		phase_error_supported = (oscillator_get_phase_error(oscillator, &phase_error) != -ENOSYS);
-		if (phase_error_supported)
-			sign = 1;
-		pthread_mutex_lock(&monitoring->mutex);
-		monitoring->phase_error_supported = phase_error_supported;
-		pthread_mutex_unlock(&monitoring->mutex);
-	}
+	/*
+	 * Oscillator, GNSS receiver and EEPROM are independent: oscillator is
+	 * created and EEPROM read in their own threads while GNSS receiver is
+	 * brought up, as oscillator and receiver may both need a reset.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &startup);
+	init_step_start(&oscillator_step);
+	if (disciplining_mode)
+		init_step_start(&eeprom_step);
 
 	/* Open PTP clock file descriptor */
 	fd_clock = open(devices_path.ptp_path, O_RDWR);
@@ -327,39 +484,71 @@ int main(int argc, char *argv[])
 
 	/* Start GNSS Thread */
 	char flip_flip_path[5000];
-	snprintf(flip_flip_path, sizeof(flip_flip_path) - 1, "%s@115200", devices_path.gnss_path);
-	gnss = gnss_init(&config, flip_flip_path, &session, fd_clock);
-	if (gnss == NULL) {
+	/* gnss-device-tty overrides the tty detected, e.g to replay a capture */
+	const char *gnss_tty = config_get(&config, "gnss-device-tty");
+	if (gnss_tty != NULL)
+		log_info("Using GNSS tty %s instead of %s", gnss_tty, devices_path.gnss_path);
+	snprintf(flip_flip_path, sizeof(flip_flip_path) - 1, "%s@115200",
+		gnss_tty != NULL ? gnss_tty : devices_path.gnss_path);
+	clock_gettime(CLOCK_MONOTONIC, &gnss_start);
+	gnss_selector = gnss_selector_init(&config, flip_flip_path, &session, fd_clock);
+	if (gnss_selector == NULL) {
 		error(EXIT_FAILURE, errno, "Failed to listen to the receiver");
 		return -EINVAL;
 	}
+	boot_timeline_mark(BOOT_GNSS_CONFIGURED);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	log_info("Startup: GNSS ready in %.3fs", (now.tv_sec - gnss_start.tv_sec) +
+		(now.tv_nsec - gnss_start.tv_nsec) / 1e9);
+	gnss = gnss_selector_active(gnss_selector);
 	if (monitoring) {
-		gnss->gnss_info = &monitoring->gnss_info;
+		gnss_selector_set_monitoring(gnss_selector, &monitoring->gnss_info);
 	}
 
+	/* Join barrier: all devices are needed from now on */
+	ret = init_step_join(&oscillator_step);
+	if (ret < 0) {
+		error(EXIT_FAILURE, -ret, "oscillator_factory_new");
+		return -EINVAL;
+	}
+	boot_timeline_mark_at(BOOT_OSCILLATOR_READY, &oscillator_step.end);
+	log_info("oscillator model %s", oscillator->class->name);
 	if (disciplining_mode) {
-		/* Get disciplining parameters files exposed by driver */
-		ret = read_disciplining_parameters_from_eeprom(
-			devices_path.disciplining_config_path,
-			devices_path.temperature_table_path,
-			&dsc_params
-		);
-		if (ret != 0) {
+		if (init_step_join(&eeprom_step) != 0) {
 			log_error("Failed to read disciplining_parameters from EEPROM");
 			return -EINVAL;
 		}
-		opposite_phase_error = config_get_bool_default(&config,
-				"opposite-phase-error", false);
-		sign = opposite_phase_error ? -1 : 1;
+		boot_timeline_mark_at(BOOT_EEPROM_READ, &eeprom_step.end);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	log_info("Startup: devices ready in %.3fs", (now.tv_sec - startup.tv_sec) +
+		(now.tv_nsec - startup.tv_nsec) / 1e9);
+
+	/* Handle phase error */
+	if (monitoring_mode) {
+		phase_error_supported = (oscillator_get_phase_error(oscillator, &phase_error) != -ENOSYS);
+		if (phase_error_supported)
+			sign = 1;
+		pthread_mutex_lock(&monitoring->mutex);
+		monitoring->phase_error_supported = phase_error_supported;
+		pthread_mutex_unlock(&monitoring->mutex);
+	}
 
-		prepare_minipod_config(&minipod_config, &config);
+	if (disciplining_mode) {
 
-		/* Create shared library oscillator object */
-		od = od_new_from_config(&minipod_config, &dsc_params, err_msg);
-		if (od == NULL) {
-			error(EXIT_FAILURE, errno, "od_new %s", err_msg);
+		/* Create disciplining algorithm, control loop runs on the card's devices */
+		devices.fd_clock = fd_clock;
+		devices.gnss = gnss;
+		devices.config = &config;
+		devices.config_path = path;
+		devices.monitoring = monitoring;
+		ret = control_loop_init(&control_loop, &config, &dsc_params, oscillator,
+			&devices_ops, &devices);
+		if (ret < 0) {
+			error(EXIT_FAILURE, -ret, "control_loop_init");
 			return -EINVAL;
 		}
+		sign = control_loop.sign;
 		/* Get time to know when to save disciplining parameters */
 		time(&start_save_epprom_parameters);
 
@@ -368,6 +557,7 @@ int main(int argc, char *argv[])
 		if (phasemeter == NULL) {
 			return -EINVAL;
 		}
+		devices.phasemeter = phasemeter;
 		/* Wait for all thread to get at least one piece of data */
 		sleep(2);
 
@@ -380,6 +570,7 @@ int main(int argc, char *argv[])
 				log_error("Could not set ptp clock time: err %d", ret);
 				return -EINVAL;
 			}
+			boot_timeline_mark(BOOT_PHC_SET);
 		}
 		phase_error_supported = true;
 
@@ -398,6 +589,7 @@ int main(int argc, char *argv[])
 			);
 			if (ret < 0)
 				error(EXIT_FAILURE, -ret, "apply_phase_offset");
+			boot_timeline_mark(BOOT_INITIAL_PHASE_JUMP);
 			sleep(SETTLING_TIME);
 
 			/* Check PTP Clock time is properly set */
@@ -415,164 +607,52 @@ int main(int argc, char *argv[])
 		/* Start NTP SHM session */
 		enable_pps(fd_clock, true);
 		(void)ntpshm_context_init(&context);
+		ntpshm_session_init(&session);
+		/* Sources with a configured SHM unit, before PPS takes a free one */
+		ntpshm_publisher = ntpshm_publisher_init(&config, &session, fd_clock);
 
 		/* Start PPS Thread that triggers writes in NTP SHM */
 		if (strlen(devices_path.pps_path) != 0) {
 			pps_thread->devicename = (char *)&devices_path.pps_path;
 			pps_thread->log_hook = ppsthread_log;
 			log_info("Init NTP SHM session");
-			ntpshm_session_init(&session);
+			/* Push a sample to chrony's SOCK refclock at each PHC pulse */
+			session.chrony_path = config_get(&config, "chrony-socket");
 			ntpshm_link_activate(&session);
 		} else {
 			log_warn("No pps-device found in sysfs, NTPSHM will no be filled");
+			if (config_get(&config, "chrony-socket") != NULL)
+				log_warn("chrony-socket needs pps-device, no sample will be sent to chrony");
 		}
 	}
 
 	/* Main Loop */
 	while(loop) {
-		if (disciplining_mode) {
-			/* Get Phase error and status*/
-			phasemeter_status = get_phase_error(phasemeter, &osc_attr.phase_error);
+		/* Fail over to another receiver before next pulse if needed */
+		gnss = gnss_selector_update(gnss_selector, phasemeter);
+		devices.gnss = gnss;
 
-			if (gnss_get_epoch_data(gnss, &input.valid, &input.survey_completed, &input.qErr) != 0) {
+		if (disciplining_mode) {
+			ret = control_loop_step(&control_loop);
+			if (ret == -ENODATA) {
 				log_error("Error getting GNSS data, exiting");
 				break;
-			}
-			/* Wait for phase error before getting oscillator control values */
-			/* This prevents control values to be read right after writing them */
-
-			/* Oscillator control values and temperature are needed for
-			* the disciplining algorithm and monitoring, get both of them
-			*/
-			ret = oscillator_parse_attributes(oscillator, &osc_attr);
-			if (ret == -ENOSYS) {
-				osc_attr.temperature = 0.0;
-				osc_attr.locked = false;
-			} else if (ret < 0) {
-				log_warn("Coud not get temperature of oscillator");
-				continue;
-			}
-
-			ret = oscillator_get_ctrl(oscillator, &ctrl_values);
-			if (ret != 0) {
-				log_warn("Could not get control values of oscillator");
+			} else if (ret == -EAGAIN) {
 				continue;
+			} else if (ret < 0) {
+				error(EXIT_FAILURE, -ret, "control_loop_step");
 			}
+			osc_attr = control_loop.osc_attr;
+			ctrl_values = control_loop.ctrl_values;
+			phase_error_corrected = control_loop.phase_error_corrected;
+			qerr_matched = control_loop.qerr_matched;
 
-			if (ignore_next_irq) {
-				log_debug("ignoring 1 input due to phase jump");
-				ignore_next_irq = false;
-				continue;
-			}
-
-			/* Fills in input structure with current phasemeter status */
-			input.phasemeter_status = phasemeter_status;
-
-			if (output.action == ADJUST_FINE && output.setpoint != ctrl_values.fine_ctrl) {
-				log_error("Could not apply output to mro50");
-				log_error("Requested value was %u, control value read is %u", output.setpoint, ctrl_values.fine_ctrl);
-				//error(EXIT_FAILURE, -EIO, "apply_output");
-			}
-
-			/* Fills in input structure for disciplining algorithm */
-			input.coarse_setpoint = ctrl_values.coarse_ctrl;
-			input.fine_setpoint = ctrl_values.fine_ctrl;
-			input.temperature = osc_attr.temperature;
-			input.lock = osc_attr.locked;
-			input.phase_error = (struct timespec) {
-				.tv_sec = sign * osc_attr.phase_error / NS_IN_SECOND,
-				.tv_nsec = sign * osc_attr.phase_error % NS_IN_SECOND,
-			};
-
-			if (fake_holdover_activated) {
-				log_warn("Fake Holdover activated: make minipod think gnss is not valid");
-				input.valid = false;
-			}
-
-			log_info("input: phase_error = (%lds, %09ldns), "
-				"valid = %s, survey = %s, qErr = %d,lock = %s, fine = %d, "
-				"coarse = %d, temp = %.2f°C, calibration requested: %s",
-				input.phase_error.tv_sec,
-				input.phase_error.tv_nsec,
-				input.valid ? "true" : "false",
-				input.survey_completed ? "true" : "false",
-				input.qErr,
-				input.lock ? "true" : "false",
-				input.fine_setpoint,
-				input.coarse_setpoint,
-				input.temperature,
-				input.calibration_requested ? "true" : "false");
-
-			/* Call disciplining algorithm process loop */
-			ret = od_process(od, &input, &output);
-			if (ret < 0)
-				error(EXIT_FAILURE, -ret, "od_process");
-			/* Resets input structure to empty values */
-			input = (struct od_input) {0};
-
-			/* Process output result of the algorithm */
-			if (output.action == PHASE_JUMP) {
-				log_info("Phase jump requested");
-				ret = apply_phase_offset(
-					fd_clock,
-					devices_path.ptp_path,
-					-output.value_phase_ctrl
-				);
-
-				if (ret < 0)
-					error(EXIT_FAILURE, -ret, "apply_phase_offset");
-				ignore_next_irq = true;
-
-			} else if (output.action == CALIBRATE) {
-				log_info("Calibration requested");
-				if (monitoring_mode) {
-					pthread_mutex_lock(&monitoring->mutex);
-					od_get_monitoring_data(od, &monitoring->disciplining);
-					pthread_mutex_unlock(&monitoring->mutex);
-				}
-				struct calibration_parameters * calib_params = od_get_calibration_parameters(od);
-				if (calib_params == NULL)
-					error(EXIT_FAILURE, -ENOMEM, "od_get_calibration_parameters");
-
-				struct calibration_results *results = oscillator_calibrate(oscillator, phasemeter, gnss, calib_params, sign);
-				if (results != NULL)
-					od_calibrate(od, calib_params, results);
-				else {
-					if (!loop)
-						break;
-					else
-						error(EXIT_FAILURE, -ENOMEM, "oscillator_calibrate");
-				}
+			/* Record convergence milestones until clock is locked */
+			if (control_loop.processed > 0)
+				boot_timeline_mark(BOOT_FIRST_OD_PROCESS);
+			if (od_get_monitoring_data(control_loop.od, &od_status) == 0)
+				boot_timeline_update(&od_status);
 
-			} else if (output.action == SAVE_DISCIPLINING_PARAMETERS) {
-					ret = od_get_disciplining_parameters(od, &dsc_params);
-					if (ret != 0)
-						log_error("Could not get discipling parameters from disciplining algorithm");
-					dsc_params.dsc_config.calibration_date = time(NULL);
-
-					ret = write_disciplining_parameters_in_eeprom(
-						devices_path.disciplining_config_path,
-						devices_path.temperature_table_path,
-						&dsc_params
-					);
-					if (ret < 0) {
-						log_error("Error saving data to EEPROM");
-					} else {
-						log_info("Saved disciplining parameters into EEPROM");
-					}
-
-					/* Disable calibrate first to prevent a new calibration when rebooting */
-					config_set(&config, "calibrate_first", "false");
-					if (config_save(&config, path) != 0) {
-						log_warn("Could not disable calibration at boot in config at %s", path);
-						log_warn("If you restart oscillatord calibration will be done again !");
-					}
-			} else if (output.action != NO_OP) {
-				ret = oscillator_apply_output(oscillator, &output);
-				if (ret < 0) {
-					log_error("Could not apply output on oscillator !");
-				}
-			}
 			/* Check if time elapsed is superior to periodic time to save EEPROM data */
 			time(&end_save_eeprom_parameters);
 			if (difftime(end_save_eeprom_parameters, start_save_epprom_parameters) >= (double) UPDATE_DISCIPLINING_PARAMETERS_SEC) {
@@ -581,7 +661,7 @@ int main(int argc, char *argv[])
 					&save_dsc_params_thread,
 					NULL,
 					save_disciplining_parameters_thread,
-					od
+					control_loop.od
 				);
 				/* Reset time to save eeprom data*/
 				time(&start_save_epprom_parameters);
@@ -624,7 +704,7 @@ int main(int argc, char *argv[])
 				.ready_for_holdover = false,
 			};
 			if (disciplining_mode) {
-				if(od_get_monitoring_data(od, &disciplining) != 0) {
+				if(od_get_monitoring_data(control_loop.od, &disciplining) != 0) {
 					log_warn("Could not get disciplining data");
 					disciplining.clock_class = CLOCK_CLASS_UNCALIBRATED;
 					disciplining.status = INIT;
@@ -639,20 +719,39 @@ int main(int argc, char *argv[])
 				 */
 				oscillator_get_phase_error(oscillator, &osc_attr.phase_error);
 				oscillator_get_disciplining_status(oscillator, &disciplining);
+				phase_error_corrected = osc_attr.phase_error;
 			}
 
 			pthread_mutex_lock(&monitoring->mutex);
+			monitoring->calibration = control_loop.calibration;
 			monitoring->osc_attributes = osc_attr;
 			monitoring->ctrl_values = ctrl_values;
 			monitoring->disciplining = disciplining;
+			monitoring->phase_error_corrected = phase_error_corrected;
+			monitoring->qerr_matched = qerr_matched;
 			request = monitoring->request;
 			monitoring->request = REQUEST_NONE;
 			pthread_mutex_unlock(&monitoring->mutex);
 
+			struct history_sample sample = {
+				.timestamp = time(NULL),
+				.phase_error = osc_attr.phase_error,
+				.fine_ctrl = ctrl_values.fine_ctrl,
+				.coarse_ctrl = ctrl_values.coarse_ctrl,
+				.temperature = osc_attr.temperature,
+				.phase_error_corrected = phase_error_corrected,
+			};
+			history_add(monitoring->history, &sample);
+			monitoring_export(monitoring);
+
 			switch(request) {
 			case REQUEST_CALIBRATION:
 				log_info("Monitoring: Calibration requested");
-				input.calibration_requested = true;
+				control_loop_request_calibration(&control_loop);
+				break;
+			case REQUEST_CALIBRATION_ABORT:
+				log_info("Monitoring: Calibration abort requested");
+				control_loop_abort_calibration(&control_loop);
 				break;
 			case REQUEST_GNSS_START:
 				log_info("Monitoring: GNSS Start requested");
@@ -680,14 +779,14 @@ int main(int argc, char *argv[])
 					&save_dsc_params_thread,
 					NULL,
 					save_disciplining_parameters_thread,
-					od
+					control_loop.od
 				);
 				break;
 			case REQUEST_FAKE_HOLDOVER_START:
-				fake_holdover_activated = true;
+				control_loop.fake_holdover = true;
 				break;
 			case REQUEST_FAKE_HOLDOVER_STOP:
-				fake_holdover_activated = false;
+				control_loop.fake_holdover = false;
 				break;
 			case REQUEST_RESET_UBLOX_SERIAL:
 				log_info("Monitoring: Ublox serial reset requested");
@@ -720,16 +819,21 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	oscillator_calibration_abort(oscillator, &control_loop.calibration);
 	enable_pps(fd_clock, false);
 	if (pps_thread != NULL && pps_thread->devicename != NULL)
 		ntpshm_link_deactivate(&session);
 
-	gnss_stop(gnss);
+	gnss_selector_stop(gnss_selector);
+	ntpshm_publisher_stop(ntpshm_publisher);
+
+	/* Logged here if clock never locked */
+	boot_timeline_log();
 
 	if (disciplining_mode) {
 		pthread_join(save_dsc_params_thread, NULL);
 		phasemeter_stop(phasemeter);
-		ret = od_get_disciplining_parameters(od, &dsc_params);
+		ret = od_get_disciplining_parameters(control_loop.od, &dsc_params);
 		if (ret != 0) {
 			log_error("Could not get discipling parameters from disciplining algorithm");
 		} else {
@@ -745,7 +849,7 @@ int main(int argc, char *argv[])
 			else
 				log_info("Saved calibration parameters into EEPROM");
 		}
-		od_destroy(&od);
+		control_loop_cleanup(&control_loop);
 	}
 	if (monitoring_mode)
 		monitoring_stop(monitoring);
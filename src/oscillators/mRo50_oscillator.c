@@ -49,6 +49,13 @@
 
 #define RESET_TIMEOUT 300
 
+/* Calibration measures phase error every other pulse */
+#define MRO50_CALIBRATION_PERIOD 2
+/* Adaptive calibration: minimum measures per point before stopping */
+#define MRO50_CALIBRATION_MIN_MEASURES 10
+/* Two sided 95% quantile of the normal distribution */
+#define MRO50_CALIBRATION_Z95 1.96
+
 typedef u_int32_t uint32_t;
 typedef u_int32_t u32;
 
@@ -496,92 +503,191 @@ static int mRo50_oscillator_apply_output(struct oscillator *oscillator, struct o
 	return 0;
 }
 
-static struct calibration_results * mRo50_oscillator_calibrate(struct oscillator *oscillator,
-		struct phasemeter *phasemeter, struct gnss *gnss, struct calibration_parameters *calib_params,
-		int phase_sign)
+static void calibration_fit_add(struct calibration_fit *fit, double t, double y)
 {
-	struct od_output adj_fine = { .action = ADJUST_FINE, .setpoint = 0, };
-	int ret;
-	int64_t phase_error;
+	if (fit->n == 0)
+		fit->y0 = y;
+	y -= fit->y0;
+	fit->n++;
+	fit->sum_t += t;
+	fit->sum_y += y;
+	fit->sum_tt += t * t;
+	fit->sum_ty += t * y;
+	fit->sum_yy += y * y;
+}
 
-	struct calibration_results *results = malloc(sizeof(struct calibration_results));
-	if (results == NULL) {
-		log_error("Could not allocate memory to create calibration_results");
-		return NULL;
-	}
+/**
+ * @brief Least squares line of phase error over time
+ *
+ * @param fit
+ * @param intercept phase error at first measure, in ns
+ * @param slope drift in ns/s
+ * @param slope_stderr standard error of the drift in ns/s
+ * @return 0 on success, -EAGAIN if there are not enough measures
+ */
+static int calibration_fit_solve(const struct calibration_fit *fit, double *intercept,
+	double *slope, double *slope_stderr)
+{
+	double stt = fit->sum_tt - fit->sum_t * fit->sum_t / fit->n;
+	double sty = fit->sum_ty - fit->sum_t * fit->sum_y / fit->n;
+	double syy = fit->sum_yy - fit->sum_y * fit->sum_y / fit->n;
+	double residuals;
+
+	if (fit->n < 3 || stt <= 0.0)
+		return -EAGAIN;
+	*slope = sty / stt;
+	*intercept = fit->y0 + (fit->sum_y - *slope * fit->sum_t) / fit->n;
+	residuals = syy - *slope * sty;
+	*slope_stderr = sqrt((residuals > 0.0 ? residuals : 0.0) / (fit->n - 2) / stt);
+	return 0;
+}
 
-	results->length = calib_params->length;
-	results->nb_calibration = calib_params->nb_calibration;
-	results->measures = malloc(results->length * results->nb_calibration * sizeof(struct timespec));
-	if (results->measures == NULL) {
-		log_error("Could not allocate memory to create calibration measures");
-		free(results);
-		results = NULL;
-		return NULL;
+/**
+ * @brief Adaptive calibration: add a measure to the fit of the control point
+ *
+ * Once the drift is known within tolerance, or the maximum number of
+ * measures is reached, the measures of the control point expected by the
+ * disciplining algorithm are filled from the fitted line, at the spacing of
+ * the non adaptive calibration.
+ *
+ * @return true if control point is done
+ */
+static bool mRo50_calibration_fit_measure(struct oscillator_calibration *calibration, double measure)
+{
+	struct calibration_results *results = calibration->results;
+	struct calibration_fit *fit = &calibration->fit;
+	double intercept, slope, slope_stderr;
+	double tolerance = calibration->settings.drift_tolerance_ps / 1000.0;
+	float *measures;
+
+	calibration_fit_add(fit, fit->n, measure);
+	if (calibration_fit_solve(fit, &intercept, &slope, &slope_stderr) != 0)
+		return false;
+	if (fit->n < calibration->measures &&
+		(fit->n < MRO50_CALIBRATION_MIN_MEASURES ||
+		 MRO50_CALIBRATION_Z95 * slope_stderr > tolerance))
+		return false;
+
+	log_info("Control point %d/%d: drift %.4f ns/s +/- %.4f after %d measures",
+		calibration->point + 1, calibration->points, slope,
+		MRO50_CALIBRATION_Z95 * slope_stderr, fit->n);
+	if (MRO50_CALIBRATION_Z95 * slope_stderr > tolerance)
+		log_warn("Drift tolerance of %d ps/s not reached", calibration->settings.drift_tolerance_ps);
+
+	measures = &results->measures[calibration->point * results->nb_calibration];
+	for (int j = 0; j < results->nb_calibration; j++)
+		measures[j] = intercept + slope * j * MRO50_CALIBRATION_PERIOD;
+	return true;
+}
+
+/**
+ * @brief Apply control point of the calibration and wait for oscillator to settle
+ */
+static int mRo50_calibration_apply_point(struct oscillator *oscillator,
+		struct oscillator_calibration *calibration)
+{
+	struct od_output adj_fine = {
+		.action = ADJUST_FINE,
+		.setpoint = (uint32_t) calibration->params->ctrl_points[calibration->point],
+	};
+
+	log_info("Applying fine adjustment of %d", adj_fine.setpoint);
+	if (mRo50_oscillator_apply_output(oscillator, &adj_fine) < 0) {
+		log_error("Could not write to mRO50");
+		return CALIBRATION_FAILED;
 	}
-	log_info("Starting measure for calibration");
-	for (int i = 0; i < results->length; i ++) {
-		if (!loop)
-			goto clean_calibration;
-		adj_fine.setpoint = (uint32_t) calib_params->ctrl_points[i];
-		log_info("Applying fine adjustment of %d", adj_fine.setpoint);
-		ret = mRo50_oscillator_apply_output(oscillator, &adj_fine);
-		if (ret < 0) {
-			free(results->measures);
-			log_error("Could not write to mRO50");
-			results->measures = NULL;
-			free(results);
-			results = NULL;
-			return NULL;
+	calibration->wait = SETTLING_TIME;
+	calibration->measure = 0;
+	memset(&calibration->fit, 0, sizeof(calibration->fit));
+	return CALIBRATION_SETTLING;
+}
+
+/**
+ * @brief Calibration step, called once per main loop iteration
+ *
+ * Each control point is applied, left to settle for SETTLING_TIME iterations,
+ * then measured on nb_calibration phase errors, one every period iterations,
+ * corrected by the quantization error of their pulse.
+ * In adaptive mode, phase error is measured at every pulse and fitted until
+ * the drift is known within the configured tolerance.
+ */
+static int mRo50_oscillator_calibrate(struct oscillator *oscillator,
+		struct oscillator_calibration *calibration, const struct calibration_sample *sample)
+{
+	struct calibration_results *results = calibration->results;
+	struct oscillator_ctrl ctrl;
+	uint32_t setpoint;
+	int32_t qErr;
+
+	switch (calibration->state) {
+	case CALIBRATION_APPLY:
+		if (calibration->period == 0 && calibration->settings.adaptive) {
+			/* Every pulse, never longer than non adaptive calibration by default */
+			calibration->period = 1;
+			calibration->measures = calibration->settings.max_measures > 0 ?
+				calibration->settings.max_measures :
+				results->nb_calibration * MRO50_CALIBRATION_PERIOD;
+			log_info("Adaptive calibration: drift tolerance %d ps/s, at most %d measures per point",
+				calibration->settings.drift_tolerance_ps, calibration->measures);
+		} else if (calibration->period == 0) {
+			calibration->period = MRO50_CALIBRATION_PERIOD;
 		}
-		sleep(SETTLING_TIME);
+		calibration->state = mRo50_calibration_apply_point(oscillator, calibration);
+		break;
 
-		struct oscillator_ctrl ctrl;
-		ret = mRo50_oscillator_get_ctrl(oscillator, &ctrl);
-		if (ctrl.fine_ctrl != adj_fine.setpoint) {
-			log_info("ctrl measured is %d and ctrl point is %d", ctrl.fine_ctrl, adj_fine.setpoint);
+	case CALIBRATION_SETTLING:
+		if (--calibration->wait > 0)
+			break;
+		setpoint = (uint32_t) calibration->params->ctrl_points[calibration->point];
+		if (mRo50_oscillator_get_ctrl(oscillator, &ctrl) == 0 && ctrl.fine_ctrl != setpoint) {
+			log_info("ctrl measured is %d and ctrl point is %d", ctrl.fine_ctrl, setpoint);
 			log_error("CTRL POINTS HAS NOT BEEN SET !");
 		}
+		log_info("Starting phase error measures %d/%d", calibration->point + 1, calibration->points);
+		calibration->state = CALIBRATION_MEASURING;
+		break;
 
-		log_info("Starting phase error measures %d/%d", i+1, results->length);
-		for (int j = 0; j < results->nb_calibration; j++) {
-			if (!loop)
-				goto clean_calibration;
-			int phasemeter_status = get_phase_error(phasemeter, &phase_error);
-			if (phasemeter_status != PHASEMETER_BOTH_TIMESTAMPS) {
-				log_error("Could not get phase error during calibration, aborting");
-				free(results->measures);
-				results->measures = NULL;
-				free(results);
-				results = NULL;
-				return NULL;
-			}
-			/* Get qErr in ps*/
-			int32_t qErr;
-			if (gnss_get_epoch_data(gnss, NULL, NULL, &qErr) != 0) {
-				log_error("Could not get gnss data");
-				free(results->measures);
-				results->measures = NULL;
-				free(results);
-				results = NULL;
-				return NULL;
-			}
-
-			*(results->measures + i * results->nb_calibration + j) = phase_error + (float) qErr / 1000;
-			log_debug("ctrl_point %d measure[%d]: phase error = %lld, qErr = %d, result = %f",
-				adj_fine.setpoint, j, phase_error, qErr, phase_error + (float) qErr / 1000);
-			sleep(1);
+	case CALIBRATION_MEASURING:
+		if (calibration->wait > 0) {
+			calibration->wait--;
+			break;
+		}
+		if (sample->phasemeter_status != PHASEMETER_BOTH_TIMESTAMPS) {
+			log_error("Could not get phase error during calibration, aborting");
+			calibration->state = CALIBRATION_FAILED;
+			break;
+		}
+		qErr = sample->qErr;
+		if (!sample->qerr_matched) {
+			log_warn("No quantization error for pulse, measure is not corrected");
+			qErr = 0;
 		}
+		log_debug("ctrl_point %d measure[%d]: phase error = %lld, qErr = %d, result = %f",
+			(int) calibration->params->ctrl_points[calibration->point], calibration->measure,
+			(long long) sample->phase_error, qErr, sample->phase_error + (float) qErr / 1000);
+		calibration->wait = calibration->period - 1;
+		calibration->measure++;
+
+		if (calibration->settings.adaptive) {
+			if (!mRo50_calibration_fit_measure(calibration, sample->phase_error + (double) qErr / 1000))
+				break;
+		} else {
+			results->measures[calibration->point * results->nb_calibration + calibration->measure - 1] =
+				sample->phase_error + (float) qErr / 1000;
+			if (calibration->measure < calibration->measures)
+				break;
+		}
+		if (++calibration->point < calibration->points)
+			calibration->state = mRo50_calibration_apply_point(oscillator, calibration);
+		else
+			calibration->state = CALIBRATION_DONE;
+		break;
+
+	default:
+		break;
 	}
 
-	return results;
-
-clean_calibration:
-	free(results->measures);
-	results->measures = NULL;
-	free(results);
-	results = NULL;
-	return NULL;
+	return calibration->state;
 }
 
 static const struct oscillator_factory mRo50_oscillator_factory = {
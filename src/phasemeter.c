@@ -24,7 +24,6 @@
 #include "phasemeter.h"
 
 #define EXTTS_INDEX_ART_INTERNAL_PPS 5
-#define EXTTS_INDEX_GNSS_PPS 0
 
 #define MILLISECONDS_500 500000000
 
@@ -111,6 +110,24 @@ static int disable_extts(int fd, unsigned int extts_index)
 	return 0;
 }
 
+/**
+ * @brief Read external timestamps until one of the inputs of the phasemeter is received
+ *
+ * @param phasemeter
+ * @param ts timestamp read
+ * @param gnss_index index of the GNSS PPS input currently measured
+ */
+static void read_phasemeter_input(struct phasemeter *phasemeter, struct external_timestamp *ts,
+	unsigned int gnss_index)
+{
+	do {
+		ts->index = read_extts(phasemeter->fd, &ts->timestamp);
+		if (ts->index < 0) {
+			log_warn("Could not read ptp clock external timestamp for phasemeter");
+		}
+	} while (ts->index != EXTTS_INDEX_ART_INTERNAL_PPS && ts->index != (int) gnss_index);
+}
+
 /**
  * @brief Phasemeter thread routine
  *
@@ -124,38 +141,35 @@ static void* phasemeter_thread(void *p_data)
 	struct phasemeter *phasemeter = (struct phasemeter *) p_data;
 	struct external_timestamp ts1;
 	struct external_timestamp ts2;
+	unsigned int gnss_index;
 
 	stop = phasemeter->stop;
+	gnss_index = __atomic_load_n(&phasemeter->gnss_index, __ATOMIC_ACQUIRE);
 
 	ret = enable_extts(phasemeter->fd, EXTTS_INDEX_ART_INTERNAL_PPS);
 	if (ret != 0) {
 		log_error("Could not enable ART internal pps external events");
 		return NULL;
 	}
-	ret = enable_extts(phasemeter->fd, EXTTS_INDEX_GNSS_PPS);
+	ret = enable_extts(phasemeter->fd, gnss_index);
 	if (ret != 0) {
 		log_error("Could not enable GNSS pps external events");
 		return NULL;
 	}
 
 	/* Get first timestamp */
-	do {
-		ts1.index = read_extts(phasemeter->fd, &ts1.timestamp);
-		if (ts1.index < 0) {
-			log_warn("Could not read ptp clock external timestamp for phasemeter");
-		}
-	} while (ts1.index != EXTTS_INDEX_ART_INTERNAL_PPS && ts1.index != EXTTS_INDEX_GNSS_PPS);
+	read_phasemeter_input(phasemeter, &ts1, gnss_index);
 
 	while(!stop) {
+		/* GNSS input may be switched to another receiver at any time */
+		gnss_index = __atomic_load_n(&phasemeter->gnss_index, __ATOMIC_ACQUIRE);
+		if (ts1.index != EXTTS_INDEX_ART_INTERNAL_PPS && ts1.index != (int) gnss_index)
+			read_phasemeter_input(phasemeter, &ts1, gnss_index);
+
 		/* Get Second timestamp */
-		do {
-			ts2.index = read_extts(phasemeter->fd, &ts2.timestamp);
-			if (ts2.index < 0) {
-				log_warn("Could not read ptp clock external timestamp for phasemeter");
-			}
-		} while (ts2.index != EXTTS_INDEX_ART_INTERNAL_PPS && ts2.index != EXTTS_INDEX_GNSS_PPS);
-		log_debug("Phasemeter: %s, ts %" PRIi64 , (ts1.index == EXTTS_INDEX_GNSS_PPS)? "GNSS" : "INT ", ts1.timestamp);
-		log_debug("Phasemeter: %s, ts %" PRIi64 , (ts2.index == EXTTS_INDEX_GNSS_PPS)? "GNSS" : "INT ", ts2.timestamp);
+		read_phasemeter_input(phasemeter, &ts2, gnss_index);
+		log_debug("Phasemeter: %s, ts %" PRIi64 , (ts1.index == (int) gnss_index)? "GNSS" : "INT ", ts1.timestamp);
+		log_debug("Phasemeter: %s, ts %" PRIi64 , (ts2.index == (int) gnss_index)? "GNSS" : "INT ", ts2.timestamp);
 
 		/*
 		 * Did not received GNSS PPS external event
@@ -175,7 +189,7 @@ static void* phasemeter_thread(void *p_data)
 		 * Did not received ART Internal PPS event
 		 * This case should not happen
 		 */
-		} else if (ts1.index == EXTTS_INDEX_GNSS_PPS && ts1.index == ts2.index) {
+		} else if (ts1.index == (int) gnss_index && ts1.index == ts2.index) {
 			log_warn("Phasemeter: Did not receive ART internal pps event");
 			pthread_mutex_lock(&phasemeter->mutex);
 			phasemeter->status = PHASEMETER_NO_ART_INTERNAL_TIMESTAMPS;
@@ -190,7 +204,7 @@ static void* phasemeter_thread(void *p_data)
 		 */
 		} else {
 			int64_t timestamp_diff = ts2.timestamp - ts1.timestamp;
-			timestamp_diff = (ts1.index == EXTTS_INDEX_GNSS_PPS) ? -timestamp_diff : timestamp_diff;
+			timestamp_diff = (ts1.index == (int) gnss_index) ? -timestamp_diff : timestamp_diff;
 			/*
 			 * Phase error is superior to 500ms
 			 * Wait next timestamp
@@ -200,20 +214,21 @@ static void* phasemeter_thread(void *p_data)
 				memcpy(&ts1, &ts2, sizeof(struct external_timestamp));
 				continue;
 			}
-			log_debug("Phasemeter: phase_error: %" PRIi64 "ns", timestamp_diff);
+			/* PHC is set to TAI, GNSS PPS is within 500ms of its second */
+			int64_t gnss_timestamp = (ts1.index == (int) gnss_index) ?
+				ts1.timestamp : ts2.timestamp;
+			int64_t pps_second = (gnss_timestamp + MILLISECONDS_500) / 1000000000LL;
+			log_debug("Phasemeter: phase_error: %" PRIi64 "ns, GNSS PPS second %" PRIi64,
+				timestamp_diff, pps_second);
 			pthread_mutex_lock(&phasemeter->mutex);
 			phasemeter->status = PHASEMETER_BOTH_TIMESTAMPS;
 			phasemeter->phase_error = timestamp_diff;
+			phasemeter->pps_second = pps_second;
 			stop = phasemeter->stop;
 			pthread_cond_signal(&phasemeter->cond);
 			pthread_mutex_unlock(&phasemeter->mutex);
 			/* Get first timestamp */
-			do {
-				ts1.index = read_extts(phasemeter->fd, &ts1.timestamp);
-				if (ts1.index < 0) {
-					log_warn("Could not read ptp clock external timestamp for phasemeter");
-				}
-			} while (ts1.index != EXTTS_INDEX_ART_INTERNAL_PPS && ts1.index != EXTTS_INDEX_GNSS_PPS);
+			read_phasemeter_input(phasemeter, &ts1, gnss_index);
 		}
 	}
 
@@ -222,7 +237,7 @@ static void* phasemeter_thread(void *p_data)
 	if (ret != 0) {
 		log_error("Could not disable ART internal pps external events");
 	}
-	ret = disable_extts(phasemeter->fd, EXTTS_INDEX_GNSS_PPS);
+	ret = disable_extts(phasemeter->fd, __atomic_load_n(&phasemeter->gnss_index, __ATOMIC_ACQUIRE));
 	if (ret != 0) {
 		log_error("Could not disable GNSS pps external events");
 	}
@@ -247,6 +262,8 @@ struct phasemeter* phasemeter_init(int fd)
 	phasemeter->fd = fd;
 	phasemeter->stop = false;
 	phasemeter->status = PHASEMETER_INIT;
+	phasemeter->pps_second = 0;
+	phasemeter->gnss_index = EXTTS_INDEX_GNSS_PPS;
 
 	if (pthread_mutex_init(&phasemeter->mutex, NULL) != 0) {
 		printf("\n mutex init failed\n");
@@ -292,6 +309,37 @@ void phasemeter_stop(struct phasemeter *phasemeter)
 	return;
 }
 
+/**
+ * @brief Measure phase error against the PPS of another GNSS receiver
+ *
+ * New input is enabled before the previous one is disabled, so that
+ * switching takes effect on the next pulse.
+ *
+ * @param phasemeter
+ * @param extts_index index of the PHC external timestamp the PPS is wired to
+ * @return 0 on success, -1 on failure
+ */
+int phasemeter_set_gnss_input(struct phasemeter *phasemeter, unsigned int extts_index)
+{
+	unsigned int previous;
+
+	if (phasemeter == NULL || extts_index == EXTTS_INDEX_ART_INTERNAL_PPS)
+		return -1;
+	previous = __atomic_load_n(&phasemeter->gnss_index, __ATOMIC_ACQUIRE);
+	if (previous == extts_index)
+		return 0;
+
+	if (enable_extts(phasemeter->fd, extts_index) != 0) {
+		log_error("Could not enable GNSS pps external events on input %u", extts_index);
+		return -1;
+	}
+	__atomic_store_n(&phasemeter->gnss_index, extts_index, __ATOMIC_RELEASE);
+	if (disable_extts(phasemeter->fd, previous) != 0)
+		log_warn("Could not disable GNSS pps external events on input %u", previous);
+	log_info("Phasemeter: measuring GNSS PPS on input %u", extts_index);
+	return 0;
+}
+
 /**
  * @brief Get phase error from the thread
  *
@@ -300,11 +348,28 @@ void phasemeter_stop(struct phasemeter *phasemeter)
  * @return int phasemeter status
  */
 int get_phase_error(struct phasemeter *phasemeter, int64_t *phase_error)
+{
+	return get_phase_error_sample(phasemeter, phase_error, NULL);
+}
+
+/**
+ * @brief Get phase error from the thread along with the pulse it was measured on
+ *
+ * @param phasemeter thread structure data
+ * @param phase_error pointer where phase error will be stored
+ * @param pps_second pointer where PHC second of the GNSS PPS will be stored,
+ * only meaningful if status is PHASEMETER_BOTH_TIMESTAMPS, may be NULL
+ * @return int phasemeter status
+ */
+int get_phase_error_sample(struct phasemeter *phasemeter, int64_t *phase_error,
+	int64_t *pps_second)
 {
 	int status;
 	pthread_mutex_lock(&phasemeter->mutex);
 	pthread_cond_wait(&phasemeter->cond, &phasemeter->mutex);
 	*phase_error = phasemeter->phase_error;
+	if (pps_second != NULL)
+		*pps_second = phasemeter->pps_second;
 	status = phasemeter->status;
 	pthread_mutex_unlock(&phasemeter->mutex);
 	
@@ -16,6 +16,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/** Index of external timestamp of the PPS of the card's GNSS receiver */
+#define EXTTS_INDEX_GNSS_PPS 0
+
 /**
  * @struct phasemeter
  * @brief general structure for phasemeter thread
@@ -26,6 +29,10 @@ struct phasemeter {
 	pthread_mutex_t mutex;
 	pthread_cond_t cond;
 	int32_t phase_error;
+	/** Index of external timestamp of the GNSS PPS measured */
+	unsigned int gnss_index;
+	/** PHC second of the GNSS PPS the phase error was measured on */
+	int64_t pps_second;
 	int status;
 	int fd;
 	bool stop;
@@ -33,6 +40,9 @@ struct phasemeter {
 
 struct phasemeter* phasemeter_init(int fd);
 void phasemeter_stop(struct phasemeter *phasemeter);
+int phasemeter_set_gnss_input(struct phasemeter *phasemeter, unsigned int extts_index);
 int get_phase_error(struct phasemeter *phasemeter, int64_t *phase_error);
+int get_phase_error_sample(struct phasemeter *phasemeter, int64_t *phase_error,
+	int64_t *pps_second);
 
 #endif /* OSCILLATORD_PHASEMETER_H */
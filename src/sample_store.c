@@ -0,0 +1,474 @@
+/**
+ * @file sample_store.c
+ * @brief Compressed in memory store of timestamped samples
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Bits are written most significant first. Layout of a sample:
+ * - first sample of a block: 64 bits timestamp, then each value in full,
+ * - timestamp delta of delta: '0' when null, '10' + 7 bits, '110' + 9 bits,
+ *   '1110' + 12 bits or '1111' + 32 bits,
+ * - integers: zig-zag encoded difference written as a varint of 8 bits
+ *   groups,
+ * - floats: '0' when equal to previous value, '10' + meaningful bits when
+ *   they fit in previous window, else '11' + 5 bits leading zeros count +
+ *   6 bits meaningful bits count - 1 + meaningful bits.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "sample_store.h"
+
+#define NO_WINDOW 0xff
+
+/** Worst case size of timestamp encoding in bits */
+#define TIMESTAMP_MAX_BITS 64
+/** Worst case size of a 64 bits varint in bits */
+#define INT_MAX_BITS (10 * 8)
+/** Worst case size of a float in bits */
+#define FLOAT_MAX_BITS (2 + 5 + 6 + 64)
+
+static void bits_write(struct sample_store_block *block, uint64_t value, int nbits)
+{
+	while (nbits > 0) {
+		int room = 8 - block->bit_len % 8;
+		int n = nbits < room ? nbits : room;
+		uint8_t chunk = (value >> (nbits - n)) & ((1u << n) - 1);
+
+		block->data[block->bit_len / 8] |= chunk << (room - n);
+		block->bit_len += n;
+		nbits -= n;
+	}
+}
+
+static uint64_t bits_read(const uint8_t *data, uint32_t *pos, int nbits)
+{
+	uint64_t value = 0;
+
+	while (nbits > 0) {
+		int avail = 8 - *pos % 8;
+		int n = nbits < avail ? nbits : avail;
+		uint8_t byte = data[*pos / 8];
+
+		value = (value << n) | ((byte >> (avail - n)) & ((1u << n) - 1));
+		*pos += n;
+		nbits -= n;
+	}
+	return value;
+}
+
+static uint64_t zigzag_encode(int64_t value)
+{
+	return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+	return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static void varint_write(struct sample_store_block *block, uint64_t value)
+{
+	while (value >= 0x80) {
+		bits_write(block, (value & 0x7f) | 0x80, 8);
+		value >>= 7;
+	}
+	bits_write(block, value, 8);
+}
+
+static uint64_t varint_read(const uint8_t *data, uint32_t *pos)
+{
+	uint64_t value = 0;
+	int shift = 0;
+	uint64_t byte;
+
+	do {
+		byte = bits_read(data, pos, 8);
+		value |= (byte & 0x7f) << shift;
+		shift += 7;
+	} while ((byte & 0x80) && shift < 64);
+	return value;
+}
+
+static uint64_t double_to_bits(double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static double bits_to_double(uint64_t bits)
+{
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void timestamp_write(struct sample_store_block *block, int64_t dod)
+{
+	if (dod == 0) {
+		bits_write(block, 0x0, 1);
+	} else if (dod >= -63 && dod <= 64) {
+		bits_write(block, 0x2, 2);
+		bits_write(block, dod + 63, 7);
+	} else if (dod >= -255 && dod <= 256) {
+		bits_write(block, 0x6, 3);
+		bits_write(block, dod + 255, 9);
+	} else if (dod >= -2047 && dod <= 2048) {
+		bits_write(block, 0xe, 4);
+		bits_write(block, dod + 2047, 12);
+	} else {
+		bits_write(block, 0xf, 4);
+		bits_write(block, (uint32_t) (int32_t) dod, 32);
+	}
+}
+
+static int64_t timestamp_read(const uint8_t *data, uint32_t *pos)
+{
+	int prefix = 0;
+
+	while (prefix < 4 && bits_read(data, pos, 1) == 1)
+		prefix++;
+
+	switch (prefix) {
+	case 0:
+		return 0;
+	case 1:
+		return (int64_t) bits_read(data, pos, 7) - 63;
+	case 2:
+		return (int64_t) bits_read(data, pos, 9) - 255;
+	case 3:
+		return (int64_t) bits_read(data, pos, 12) - 2047;
+	default:
+		return (int32_t) bits_read(data, pos, 32);
+	}
+}
+
+static void float_write(struct sample_store_block *block, int i, uint64_t value)
+{
+	uint64_t xor = value ^ block->prev_float[i];
+	int leading;
+	int trailing;
+
+	block->prev_float[i] = value;
+	if (xor == 0) {
+		bits_write(block, 0x0, 1);
+		return;
+	}
+
+	leading = __builtin_clzll(xor);
+	trailing = __builtin_ctzll(xor);
+	if (leading > 31)
+		leading = 31;
+
+	if (block->prev_leading[i] != NO_WINDOW &&
+		leading >= block->prev_leading[i] &&
+		trailing >= block->prev_trailing[i]) {
+		int meaningful = 64 - block->prev_leading[i] - block->prev_trailing[i];
+		bits_write(block, 0x2, 2);
+		bits_write(block, xor >> block->prev_trailing[i], meaningful);
+	} else {
+		int meaningful = 64 - leading - trailing;
+		bits_write(block, 0x3, 2);
+		bits_write(block, leading, 5);
+		bits_write(block, meaningful - 1, 6);
+		bits_write(block, xor >> trailing, meaningful);
+		block->prev_leading[i] = leading;
+		block->prev_trailing[i] = trailing;
+	}
+}
+
+static uint64_t float_read(struct sample_store_cursor *cursor, const uint8_t *data, int i)
+{
+	if (bits_read(data, &cursor->bit_pos, 1) == 0)
+		return cursor->floats[i];
+
+	if (bits_read(data, &cursor->bit_pos, 1) == 1) {
+		cursor->leading[i] = bits_read(data, &cursor->bit_pos, 5);
+		int meaningful = bits_read(data, &cursor->bit_pos, 6) + 1;
+		cursor->trailing[i] = 64 - cursor->leading[i] - meaningful;
+	}
+	int meaningful = 64 - cursor->leading[i] - cursor->trailing[i];
+	uint64_t xor = bits_read(data, &cursor->bit_pos, meaningful) << cursor->trailing[i];
+	cursor->floats[i] ^= xor;
+	return cursor->floats[i];
+}
+
+static void block_reset(struct sample_store_block *block)
+{
+	memset(block, 0, sizeof(*block));
+	memset(block->prev_leading, NO_WINDOW, sizeof(block->prev_leading));
+}
+
+static struct sample_store_block *store_block(const struct sample_store *store, int i)
+{
+	return store->blocks[(store->start + i) % store->capacity];
+}
+
+/**
+ * @brief Create a sample store
+ *
+ * @param n_int number of integer values per sample
+ * @param n_float number of floating point values per sample
+ * @param max_memory maximum number of bytes used by blocks
+ * @param retention samples older than retention seconds are dropped,
+ * 0 to only limit memory
+ * @return struct sample_store* on success, NULL on error
+ */
+struct sample_store *sample_store_new(int n_int, int n_float, size_t max_memory,
+	time_t retention)
+{
+	struct sample_store *store;
+	int capacity;
+
+	if (n_int < 0 || n_float < 0 ||
+		n_int > SAMPLE_STORE_MAX_SERIES || n_float > SAMPLE_STORE_MAX_SERIES) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	capacity = max_memory / sizeof(struct sample_store_block);
+	if (capacity < 2)
+		capacity = 2;
+
+	store = calloc(1, sizeof(struct sample_store));
+	if (store == NULL)
+		return NULL;
+	store->blocks = calloc(capacity, sizeof(struct sample_store_block *));
+	if (store->blocks == NULL) {
+		free(store);
+		return NULL;
+	}
+	store->n_int = n_int;
+	store->n_float = n_float;
+	store->retention = retention;
+	store->capacity = capacity;
+
+	return store;
+}
+
+void sample_store_destroy(struct sample_store **store)
+{
+	struct sample_store *s;
+
+	if (store == NULL || *store == NULL)
+		return;
+	s = *store;
+	for (int i = 0; i < s->capacity; i++)
+		free(s->blocks[i]);
+	free(s->blocks);
+	free(s);
+	*store = NULL;
+}
+
+/**
+ * @brief Get a block to write a new sample in, dropping oldest block when
+ * store is full.
+ */
+static struct sample_store_block *store_new_block(struct sample_store *store)
+{
+	struct sample_store_block *block;
+	int index;
+
+	if (store->count == store->capacity) {
+		/* Recycle oldest block */
+		index = store->start;
+		store->start = (store->start + 1) % store->capacity;
+		store->count--;
+	} else {
+		index = (store->start + store->count) % store->capacity;
+	}
+
+	block = store->blocks[index];
+	if (block == NULL) {
+		block = malloc(sizeof(struct sample_store_block));
+		if (block == NULL)
+			return NULL;
+		store->blocks[index] = block;
+	}
+	block_reset(block);
+	store->count++;
+	return block;
+}
+
+static void store_drop_expired(struct sample_store *store, time_t now)
+{
+	if (store->retention <= 0)
+		return;
+
+	/* Last block is kept, it is the one being written */
+	while (store->count > 1 &&
+		store_block(store, 0)->last_timestamp < now - store->retention) {
+		store->start = (store->start + 1) % store->capacity;
+		store->count--;
+	}
+}
+
+/**
+ * @brief Append a sample to the store
+ *
+ * @param store sample store
+ * @param timestamp timestamp of the sample, must be greater than last one
+ * @param ints n_int integer values
+ * @param floats n_float floating point values
+ * @return 0 on success, -EINVAL if sample is older than last one, -ENOMEM
+ * if block allocation failed
+ */
+int sample_store_append(struct sample_store *store, time_t timestamp,
+	const int32_t *ints, const double *floats)
+{
+	struct sample_store_block *block = NULL;
+	uint32_t max_bits;
+	int i;
+
+	max_bits = TIMESTAMP_MAX_BITS + store->n_int * INT_MAX_BITS +
+		store->n_float * FLOAT_MAX_BITS;
+
+	if (store->count > 0) {
+		block = store_block(store, store->count - 1);
+		if (timestamp <= block->last_timestamp)
+			return -EINVAL;
+		if (block->bit_len + max_bits > SAMPLE_STORE_BLOCK_SIZE * 8)
+			block = NULL;
+	}
+
+	if (block == NULL) {
+		block = store_new_block(store);
+		if (block == NULL) {
+			log_error("Sample store: Could not allocate memory for block");
+			return -ENOMEM;
+		}
+	}
+
+	if (block->count == 0) {
+		block->first_timestamp = timestamp;
+		bits_write(block, (uint64_t) timestamp, 64);
+		for (i = 0; i < store->n_int; i++) {
+			varint_write(block, zigzag_encode(ints[i]));
+			block->prev_int[i] = ints[i];
+		}
+		for (i = 0; i < store->n_float; i++) {
+			block->prev_float[i] = double_to_bits(floats[i]);
+			bits_write(block, block->prev_float[i], 64);
+		}
+	} else {
+		int64_t delta = timestamp - block->last_timestamp;
+		timestamp_write(block, delta - block->prev_delta);
+		block->prev_delta = delta;
+		for (i = 0; i < store->n_int; i++) {
+			varint_write(block, zigzag_encode((int64_t) ints[i] - block->prev_int[i]));
+			block->prev_int[i] = ints[i];
+		}
+		for (i = 0; i < store->n_float; i++)
+			float_write(block, i, double_to_bits(floats[i]));
+	}
+	block->last_timestamp = timestamp;
+	block->count++;
+
+	store_drop_expired(store, timestamp);
+	return 0;
+}
+
+bool sample_store_last_timestamp(const struct sample_store *store, time_t *timestamp)
+{
+	if (store->count == 0)
+		return false;
+	*timestamp = store_block(store, store->count - 1)->last_timestamp;
+	return true;
+}
+
+/**
+ * @brief Memory used by blocks in bytes
+ */
+size_t sample_store_memory(const struct sample_store *store)
+{
+	return store->count * sizeof(struct sample_store_block);
+}
+
+/**
+ * @brief Position cursor at the first block that may contain start
+ *
+ * Blocks are found by a binary search on their first timestamp, samples
+ * before start still have to be skipped by the reader.
+ *
+ * @param store sample store
+ * @param cursor cursor to initialize
+ * @param start timestamp to seek to
+ */
+void sample_store_seek(const struct sample_store *store,
+	struct sample_store_cursor *cursor, time_t start)
+{
+	int low = 0;
+	int high = store->count;
+
+	/* Find first block whose last sample is >= start */
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (store_block(store, mid)->last_timestamp < start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->store = store;
+	cursor->block = low;
+}
+
+/**
+ * @brief Decode next sample
+ *
+ * @param cursor cursor initialized by sample_store_seek
+ * @param timestamp timestamp of the sample
+ * @param ints integer values of the sample
+ * @param floats floating point values of the sample
+ * @return true if a sample was decoded, false at the end of the store
+ */
+bool sample_store_next(struct sample_store_cursor *cursor, time_t *timestamp,
+	int32_t *ints, double *floats)
+{
+	const struct sample_store *store = cursor->store;
+	const struct sample_store_block *block;
+	int i;
+
+	while (cursor->block < store->count &&
+		cursor->index >= store_block(store, cursor->block)->count) {
+		cursor->block++;
+		cursor->index = 0;
+		cursor->bit_pos = 0;
+	}
+	if (cursor->block >= store->count)
+		return false;
+
+	block = store_block(store, cursor->block);
+	if (cursor->index == 0) {
+		cursor->timestamp = (time_t) bits_read(block->data, &cursor->bit_pos, 64);
+		cursor->delta = 0;
+		for (i = 0; i < store->n_int; i++)
+			cursor->ints[i] = zigzag_decode(varint_read(block->data, &cursor->bit_pos));
+		for (i = 0; i < store->n_float; i++) {
+			cursor->floats[i] = bits_read(block->data, &cursor->bit_pos, 64);
+			cursor->leading[i] = NO_WINDOW;
+		}
+	} else {
+		cursor->delta += timestamp_read(block->data, &cursor->bit_pos);
+		cursor->timestamp += cursor->delta;
+		for (i = 0; i < store->n_int; i++)
+			cursor->ints[i] += zigzag_decode(varint_read(block->data, &cursor->bit_pos));
+		for (i = 0; i < store->n_float; i++)
+			float_read(cursor, block->data, i);
+	}
+	cursor->index++;
+
+	*timestamp = cursor->timestamp;
+	for (i = 0; i < store->n_int; i++)
+		ints[i] = cursor->ints[i];
+	for (i = 0; i < store->n_float; i++)
+		floats[i] = bits_to_double(cursor->floats[i]);
+	return true;
+}
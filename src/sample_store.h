@@ -0,0 +1,92 @@
+/**
+ * @file sample_store.h
+ * @brief Compressed in memory store of timestamped samples
+ * @date 2023-10-02
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Samples are made of a timestamp, integer values and floating point values.
+ * They are compressed in fixed size blocks the way Facebook's Gorilla does:
+ * - timestamps as delta of delta, a single bit when sampling period is
+ *   constant,
+ * - integers as zig-zag varint of the difference with previous value,
+ * - floating point numbers XOR-ed with previous value, only meaningful bits
+ *   being written.
+ * Blocks are indexed by their first timestamp. When memory budget is
+ * exhausted or samples get older than the retention, oldest block is
+ * dropped.
+ */
+#ifndef OSCILLATORD_SAMPLE_STORE_H
+#define OSCILLATORD_SAMPLE_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define SAMPLE_STORE_MAX_SERIES 8
+/** Number of bytes of compressed data in a block */
+#define SAMPLE_STORE_BLOCK_SIZE 4096
+
+/**
+ * @struct sample_store_block
+ * @brief Block of compressed samples, along with encoder state
+ */
+struct sample_store_block {
+	time_t first_timestamp;
+	time_t last_timestamp;
+	uint32_t count;
+	/** Number of bits written in data */
+	uint32_t bit_len;
+	int64_t prev_delta;
+	int32_t prev_int[SAMPLE_STORE_MAX_SERIES];
+	uint64_t prev_float[SAMPLE_STORE_MAX_SERIES];
+	uint8_t prev_leading[SAMPLE_STORE_MAX_SERIES];
+	uint8_t prev_trailing[SAMPLE_STORE_MAX_SERIES];
+	uint8_t data[SAMPLE_STORE_BLOCK_SIZE];
+};
+
+/**
+ * @struct sample_store
+ * @brief Ring of blocks ordered by time
+ */
+struct sample_store {
+	int n_int;
+	int n_float;
+	/** Samples older than retention seconds are dropped */
+	time_t retention;
+	struct sample_store_block **blocks;
+	int capacity;
+	int start;
+	int count;
+};
+
+/**
+ * @struct sample_store_cursor
+ * @brief Position of a reader in the store
+ */
+struct sample_store_cursor {
+	const struct sample_store *store;
+	int block;
+	uint32_t index;
+	uint32_t bit_pos;
+	time_t timestamp;
+	int64_t delta;
+	int32_t ints[SAMPLE_STORE_MAX_SERIES];
+	uint64_t floats[SAMPLE_STORE_MAX_SERIES];
+	uint8_t leading[SAMPLE_STORE_MAX_SERIES];
+	uint8_t trailing[SAMPLE_STORE_MAX_SERIES];
+};
+
+struct sample_store *sample_store_new(int n_int, int n_float, size_t max_memory,
+	time_t retention);
+void sample_store_destroy(struct sample_store **store);
+int sample_store_append(struct sample_store *store, time_t timestamp,
+	const int32_t *ints, const double *floats);
+bool sample_store_last_timestamp(const struct sample_store *store, time_t *timestamp);
+size_t sample_store_memory(const struct sample_store *store);
+void sample_store_seek(const struct sample_store *store,
+	struct sample_store_cursor *cursor, time_t start);
+bool sample_store_next(struct sample_store_cursor *cursor, time_t *timestamp,
+	int32_t *ints, double *floats);
+
+#endif /* OSCILLATORD_SAMPLE_STORE_H */
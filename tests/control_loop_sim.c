@@ -0,0 +1,481 @@
+/**
+ * @file control_loop_sim.c
+ * @brief Runs the control loop against a simulated oscillator in virtual time
+ * @date 2023-10-18
+ *
+ * The control loop of oscillatord and the disciplining algorithm run
+ * unchanged, their phasemeter, GNSS and clock are replaced by a model
+ * advanced by one second at each step, as fast as the algorithm allows.
+ *
+ * Oscillator frequency, in parts per trillion, is the sum of:
+ * - a constant offset,
+ * - the effect of coarse and fine controls around their equilibrium,
+ * - a random walk,
+ * - a linear aging,
+ * - a temperature coefficient, temperature following a daily sine.
+ * GNSS pulses carry a white noise and a quantization error reported as qErr.
+ * An optional GNSS outage, during which the algorithm is in holdover, starts
+ * at simulation-holdover-start.
+ *
+ * Convergence time, the first time the algorithm reports a locked clock
+ * class, and maximum time error in holdover, drift from the phase error when
+ * GNSS was lost, are printed at the end. Exit
+ * status is failure if the limits given in configuration are not met, so
+ * that long disciplining runs can be used as a benchmark.
+ *
+ * usage: control_loop_sim CONFIG_FILE
+ */
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <error.h>
+
+#include "../src/control_loop.h"
+#include "../src/oscillator.h"
+#include "config.h"
+#include "eeprom_config.h"
+#include "log.h"
+#include "utils.h"
+
+#define SIM_DEFAULT_DURATION       (30 * 24 * 3600)
+#define SIM_DEFAULT_FINE           2400
+#define SIM_DEFAULT_COARSE         2000000
+/* measures spacing of calibration, same as mRO50 one */
+#define SIM_CALIBRATION_PERIOD     2
+#define SECONDS_IN_DAY             86400.0
+
+/* model parameters */
+struct sim_parameters {
+    double   frequency_offset_ppt;
+    double   fine_ppt_per_lsb;
+    double   coarse_ppt_per_lsb;
+    uint32_t fine_equilibrium;
+    uint32_t coarse_equilibrium;
+    /* standard deviation of the random walk step, each second */
+    double   random_walk_ppt;
+    double   aging_ppt_per_day;
+    double   tempco_ppt_per_degree;
+    double   temperature;
+    double   temperature_swing;
+    double   gnss_noise_ns;
+    double   gnss_qerr_ns;
+    int64_t  holdover_start;
+    int64_t  holdover_end;
+};
+
+struct sim_model {
+    struct oscillator     oscillator;
+    struct sim_parameters p;
+    /* virtual second of last pulse */
+    int64_t               second;
+    uint32_t              fine;
+    uint32_t              coarse;
+    double                random_walk_ppt;
+    double                temperature;
+    /* time error of the oscillator's pulse, in ns */
+    double                phase;
+    /* quantization error of last GNSS pulse, in ns */
+    double                qerr;
+    bool                  holdover;
+    /* time error of the last pulse before holdover, in ns */
+    double                holdover_phase;
+};
+
+static void signal_handler(int signum) {
+    log_info("Caught signal %s.", strsignal(signum));
+    if (!loop) {
+        log_error("Signalled twice, brutal exit.");
+        exit(EXIT_FAILURE);
+    }
+    loop = false;
+}
+
+/* returns a number following a standard normal distribution */
+static double random_gauss(void) {
+    double u1 = (random() + 1.0) / ((double)RAND_MAX + 2.0);
+    double u2 = (random() + 1.0) / ((double)RAND_MAX + 2.0);
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* returns a number uniformly distributed in [-amplitude, amplitude] */
+static double random_uniform(double amplitude) {
+    return amplitude * (2.0 * random() / (double)RAND_MAX - 1.0);
+}
+
+static double config_get_double_default(const struct config* config, const char* key,
+                                        double default_value) {
+    const char* value = config_get(config, key);
+
+    return value != NULL ? atof(value) : default_value;
+}
+
+static long config_get_long_default(const struct config* config, const char* key,
+                                    long default_value) {
+    long value = config_get_unsigned_number(config, key);
+
+    return value >= 0 ? value : default_value;
+}
+
+static double sim_frequency_ppt(const struct sim_model* model) {
+    const struct sim_parameters* p = &model->p;
+
+    return p->frequency_offset_ppt +
+           ((double)model->fine - p->fine_equilibrium) * p->fine_ppt_per_lsb +
+           ((double)model->coarse - p->coarse_equilibrium) * p->coarse_ppt_per_lsb +
+           model->random_walk_ppt + p->aging_ppt_per_day * model->second / SECONDS_IN_DAY +
+           p->tempco_ppt_per_degree * (model->temperature - p->temperature);
+}
+
+/* advance model to next pulse */
+static void sim_model_step(struct sim_model* model) {
+    double phase = model->phase;
+
+    /* frequency over the second is the one at its start, in ppt i.e ns/ks */
+    model->phase += sim_frequency_ppt(model) / 1000.0;
+    model->second++;
+    model->random_walk_ppt += model->p.random_walk_ppt * random_gauss();
+    model->temperature = model->p.temperature +
+                         model->p.temperature_swing * sin(2.0 * M_PI * model->second / SECONDS_IN_DAY);
+    model->qerr     = random_uniform(model->p.gnss_qerr_ns);
+    model->holdover = model->second >= model->p.holdover_start &&
+                      model->second < model->p.holdover_end;
+    /* holdover error is the drift from the phase the algorithm last saw */
+    if (model->second == model->p.holdover_start)
+        model->holdover_phase = phase;
+}
+
+/* control loop ops */
+
+static int sim_get_phase_error(void* data, int64_t* phase_error, int64_t* pps_second) {
+    struct sim_model* model = data;
+
+    sim_model_step(model);
+    *pps_second = model->second;
+    if (model->holdover) {
+        *phase_error = 0;
+        return PHASEMETER_NO_GNSS_TIMESTAMPS;
+    }
+    /* GNSS pulse is late by its quantization error and noise */
+    *phase_error = llround(model->phase - model->qerr - model->p.gnss_noise_ns * random_gauss());
+    return PHASEMETER_BOTH_TIMESTAMPS;
+}
+
+static int sim_get_gnss_epoch(void* data, bool* valid, bool* survey_completed) {
+    struct sim_model* model = data;
+
+    *valid            = !model->holdover;
+    *survey_completed = true;
+    return 0;
+}
+
+static int sim_get_gnss_qerr(void* data, int64_t pps_second, int32_t* qErr) {
+    struct sim_model* model = data;
+
+    if (model->holdover || pps_second != model->second)
+        return -ENOENT;
+    *qErr = lround(model->qerr * 1000.0);
+    return 0;
+}
+
+static int sim_apply_phase_offset(void* data, int64_t phase_offset) {
+    struct sim_model* model = data;
+
+    log_info("%" PRIi64 ": applying phase offset of %" PRIi64 "ns", model->second, phase_offset);
+    model->phase += phase_offset;
+    return 0;
+}
+
+static int sim_save_disciplining_parameters(void* data, struct disciplining_parameters* dsc_params) {
+    struct sim_model* model = data;
+
+    log_info("%" PRIi64 ": disciplining parameters saved", model->second);
+    print_disciplining_parameters(dsc_params, LOG_INFO);
+    return 0;
+}
+
+static const struct control_loop_ops sim_ops = {
+    .get_phase_error              = sim_get_phase_error,
+    .get_gnss_epoch               = sim_get_gnss_epoch,
+    .get_gnss_qerr                = sim_get_gnss_qerr,
+    .apply_phase_offset           = sim_apply_phase_offset,
+    .save_disciplining_parameters = sim_save_disciplining_parameters,
+};
+
+/* oscillator class */
+
+static int sim_oscillator_get_ctrl(struct oscillator* oscillator, struct oscillator_ctrl* ctrl) {
+    struct sim_model* model = container_of(oscillator, struct sim_model, oscillator);
+
+    ctrl->fine_ctrl   = model->fine;
+    ctrl->coarse_ctrl = model->coarse;
+    ctrl->dac         = model->fine;
+    return 0;
+}
+
+static int sim_oscillator_parse_attributes(struct oscillator*            oscillator,
+                                           struct oscillator_attributes* attributes) {
+    struct sim_model* model = container_of(oscillator, struct sim_model, oscillator);
+
+    attributes->temperature = model->temperature;
+    attributes->locked      = true;
+    return 0;
+}
+
+static int sim_oscillator_apply_output(struct oscillator* oscillator, struct od_output* output) {
+    struct sim_model* model = container_of(oscillator, struct sim_model, oscillator);
+
+    if (output->action == ADJUST_FINE) {
+        model->fine = output->setpoint;
+    } else if (output->action == ADJUST_COARSE) {
+        model->coarse = output->setpoint;
+    } else {
+        log_error("Unexpected action %d", output->action);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/*
+ * Same sequence as mRO50 calibration: each control point is applied, left
+ * to settle for SETTLING_TIME pulses, then measured every
+ * SIM_CALIBRATION_PERIOD pulses
+ */
+static int sim_oscillator_calibrate(struct oscillator*             oscillator,
+                                    struct oscillator_calibration* calibration,
+                                    const struct calibration_sample* sample) {
+    struct calibration_results* results = calibration->results;
+    struct od_output            adj_fine = {.action = ADJUST_FINE};
+
+    switch (calibration->state) {
+    case CALIBRATION_APPLY:
+        calibration->period = SIM_CALIBRATION_PERIOD;
+        break;
+    case CALIBRATION_SETTLING:
+        if (--calibration->wait > 0)
+            return calibration->state;
+        calibration->state = CALIBRATION_MEASURING;
+        return calibration->state;
+    case CALIBRATION_MEASURING:
+        if (calibration->wait > 0) {
+            calibration->wait--;
+            return calibration->state;
+        }
+        if (sample->phasemeter_status != PHASEMETER_BOTH_TIMESTAMPS) {
+            log_error("No phase error during calibration");
+            calibration->state = CALIBRATION_FAILED;
+            return calibration->state;
+        }
+        results->measures[calibration->point * results->nb_calibration + calibration->measure] =
+            sample->phase_error + (sample->qerr_matched ? (float)sample->qErr / 1000 : 0.0f);
+        calibration->wait = calibration->period - 1;
+        if (++calibration->measure < calibration->measures)
+            return calibration->state;
+        if (++calibration->point >= calibration->points) {
+            calibration->state = CALIBRATION_DONE;
+            return calibration->state;
+        }
+        break;
+    default:
+        return calibration->state;
+    }
+
+    /* apply control point */
+    adj_fine.setpoint = (uint32_t)calibration->params->ctrl_points[calibration->point];
+    sim_oscillator_apply_output(oscillator, &adj_fine);
+    calibration->wait    = SETTLING_TIME;
+    calibration->measure = 0;
+    calibration->state   = CALIBRATION_SETTLING;
+    return calibration->state;
+}
+
+static const struct oscillator_class sim_oscillator_class = {
+    .name             = "control_loop_sim",
+    .get_ctrl         = sim_oscillator_get_ctrl,
+    .parse_attributes = sim_oscillator_parse_attributes,
+    .apply_output     = sim_oscillator_apply_output,
+    .calibrate        = sim_oscillator_calibrate,
+};
+
+static void sim_read_parameters(const struct config* config, struct sim_parameters* p) {
+    int64_t holdover_duration;
+
+    p->frequency_offset_ppt  = config_get_double_default(config, "simulation-frequency-offset-ppt", 200.0);
+    p->fine_ppt_per_lsb      = config_get_double_default(config, "simulation-fine-ppt-per-lsb", 1.0);
+    p->coarse_ppt_per_lsb    = config_get_double_default(config, "simulation-coarse-ppt-per-lsb", 10.0);
+    p->fine_equilibrium      = config_get_long_default(config, "simulation-fine-equilibrium", SIM_DEFAULT_FINE);
+    p->coarse_equilibrium    = config_get_long_default(config, "simulation-coarse-equilibrium", SIM_DEFAULT_COARSE);
+    p->random_walk_ppt       = config_get_double_default(config, "simulation-random-walk-ppt", 0.01);
+    p->aging_ppt_per_day     = config_get_double_default(config, "simulation-aging-ppt-per-day", 1.0);
+    p->tempco_ppt_per_degree = config_get_double_default(config, "simulation-tempco-ppt-per-degree", 5.0);
+    p->temperature           = config_get_double_default(config, "simulation-temperature", 45.0);
+    p->temperature_swing     = config_get_double_default(config, "simulation-temperature-swing", 2.0);
+    p->gnss_noise_ns         = config_get_double_default(config, "simulation-gnss-noise-ns", 3.0);
+    p->gnss_qerr_ns          = config_get_double_default(config, "simulation-gnss-qerr-ns", 4.0);
+    /* 0 for no outage */
+    p->holdover_start        = config_get_long_default(config, "simulation-holdover-start", 0);
+    holdover_duration        = config_get_long_default(config, "simulation-holdover-duration", 24 * 3600);
+    if (p->holdover_start == 0)
+        p->holdover_start = INT64_MAX;
+    p->holdover_end = p->holdover_start == INT64_MAX ? INT64_MAX : p->holdover_start + holdover_duration;
+}
+
+/*
+ * disciplining parameters are read from simulation-disciplining-config and
+ * simulation-temperature-table files if given, otherwise calibration is not
+ * valid and the algorithm starts with one
+ */
+static int sim_read_disciplining_parameters(const struct config*            config,
+                                            struct disciplining_parameters* dsc_params) {
+    const char* dsc_config_path = config_get(config, "simulation-disciplining-config");
+    const char* temp_table_path = config_get(config, "simulation-temperature-table");
+    char        dsc_config[PATH_MAX];
+    char        temp_table[PATH_MAX];
+
+    memset(dsc_params, 0, sizeof(*dsc_params));
+    if (dsc_config_path == NULL || temp_table_path == NULL) {
+        dsc_params->dsc_config.header             = HEADER_MAGIC;
+        dsc_params->dsc_config.version            = DISCIPLINING_CONFIG_VERSION;
+        dsc_params->dsc_config.coarse_equilibrium = -1;
+        dsc_params->dsc_config.calibration_valid  = false;
+        dsc_params->temp_table.header             = HEADER_MAGIC;
+        dsc_params->temp_table.version            = DISCIPLINING_CONFIG_VERSION;
+        return 0;
+    }
+    snprintf(dsc_config, sizeof(dsc_config), "%s", dsc_config_path);
+    snprintf(temp_table, sizeof(temp_table), "%s", temp_table_path);
+    return read_disciplining_parameters_from_eeprom(dsc_config, temp_table, dsc_params);
+}
+
+int main(int argc, char* argv[]) {
+    struct config                config;
+    struct control_loop          control_loop;
+    struct disciplining_parameters dsc_params;
+    struct od_monitoring         monitoring;
+    struct sim_model             model = {0};
+    struct oscillator*           oscillator = &model.oscillator;
+    struct timespec              start, end;
+    const char*                  prog_name;
+    const char*                  path;
+    const char*                  output_path;
+    FILE*                        output = NULL;
+    int64_t                      duration;
+    int64_t                      output_period;
+    int64_t                      convergence = -1;
+    int64_t                      max_convergence;
+    double                       holdover_max_error = 0.0;
+    double                       max_holdover_error;
+    long                         seed;
+    int                          log_level;
+    int                          ret;
+    int                          status = EXIT_SUCCESS;
+
+    prog_name = basename(argv[0]);
+    if (argc != 2)
+        error(EXIT_FAILURE, 0, "%s config_file_path", prog_name);
+    path = argv[1];
+
+    ret = config_init(&config, path);
+    if (ret != 0)
+        error(EXIT_FAILURE, -ret, "config_init(%s)", path);
+
+    log_level = config_get_unsigned_number(&config, "debug");
+    log_set_level(log_level >= 0 ? log_level : LOG_WARN);
+
+    seed = config_get_long_default(&config, "simulation-seed", time(NULL));
+    srandom(seed);
+    duration        = config_get_long_default(&config, "simulation-duration", SIM_DEFAULT_DURATION);
+    output_period   = config_get_long_default(&config, "simulation-output-period", 60);
+    max_convergence = config_get_long_default(&config, "simulation-max-convergence", -1);
+    max_holdover_error = config_get_double_default(&config, "simulation-max-holdover-error-ns", -1.0);
+
+    sim_read_parameters(&config, &model.p);
+    model.fine        = config_get_long_default(&config, "simulation-fine", model.p.fine_equilibrium);
+    model.coarse      = config_get_long_default(&config, "simulation-coarse", model.p.coarse_equilibrium);
+    model.phase       = config_get_double_default(&config, "simulation-initial-phase-error-ns", 0.0);
+    model.temperature = model.p.temperature;
+    oscillator->class = &sim_oscillator_class;
+    snprintf(oscillator->name, sizeof(oscillator->name), "%s", sim_oscillator_class.name);
+
+    output_path = config_get(&config, "simulation-output");
+    if (output_path != NULL) {
+        output = fopen(output_path, "we");
+        if (output == NULL)
+            error(EXIT_FAILURE, errno, "fopen(%s)", output_path);
+        fprintf(output, "second,phase_error_ns,frequency_ppt,fine,coarse,temperature,clock_class,status\n");
+    }
+
+    ret = sim_read_disciplining_parameters(&config, &dsc_params);
+    if (ret != 0)
+        error(EXIT_FAILURE, 0, "Could not read disciplining parameters");
+    ret = control_loop_init(&control_loop, &config, &dsc_params, oscillator, &sim_ops, &model);
+    if (ret < 0)
+        error(EXIT_FAILURE, -ret, "control_loop_init");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    log_warn("%s started, seed %ld, %" PRIi64 "s to simulate", prog_name, seed, duration);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (loop && model.second < duration) {
+        ret = control_loop_step(&control_loop);
+        if (ret < 0 && ret != -EAGAIN)
+            error(EXIT_FAILURE, -ret, "control_loop_step");
+
+        if (model.holdover && fabs(model.phase - model.holdover_phase) > holdover_max_error)
+            holdover_max_error = fabs(model.phase - model.holdover_phase);
+        if (od_get_monitoring_data(control_loop.od, &monitoring) != 0)
+            continue;
+        if (convergence < 0 && monitoring.clock_class == CLOCK_CLASS_LOCK) {
+            convergence = model.second;
+            log_warn("%" PRIi64 ": clock class is lock", convergence);
+        }
+        if (output != NULL && output_period > 0 && model.second % output_period == 0)
+            fprintf(output, "%" PRIi64 ",%.3f,%.4f,%" PRIu32 ",%" PRIu32 ",%.3f,%s,%s\n",
+                    model.second, model.phase, sim_frequency_ppt(&model), model.fine, model.coarse,
+                    model.temperature, cstring_from_clock_class(monitoring.clock_class),
+                    cstring_from_disciplining_state(monitoring.status));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    log_warn("%" PRIi64 "s simulated in %.1fs", model.second,
+             (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    if (convergence < 0) {
+        log_error("Clock class never reached lock");
+        status = EXIT_FAILURE;
+    } else {
+        log_warn("Convergence time: %" PRIi64 "s", convergence);
+        if (max_convergence >= 0 && convergence > max_convergence) {
+            log_error("Convergence time is above %" PRIi64 "s", max_convergence);
+            status = EXIT_FAILURE;
+        }
+    }
+    if (model.p.holdover_start < model.second) {
+        log_warn("Holdover of %" PRIi64 "s: max time error %.1fns",
+                 (model.second < model.p.holdover_end ? model.second : model.p.holdover_end) -
+                     model.p.holdover_start,
+                 holdover_max_error);
+        if (max_holdover_error >= 0.0 && holdover_max_error > max_holdover_error) {
+            log_error("Max time error in holdover is above %.1fns", max_holdover_error);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if (output != NULL)
+        fclose(output);
+    control_loop_cleanup(&control_loop);
+    config_cleanup(&config);
+
+    return status;
+}
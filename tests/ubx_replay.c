@@ -0,0 +1,368 @@
+/**
+ * @file ubx_replay.c
+ * @brief Replays a GNSS capture in a pseudo terminal
+ * @date 2023-10-09
+ *
+ * Feeds a capture recorded with the gnss-capture-file option of oscillatord
+ * back into a pts, at the recorded pace scaled by a speed factor, so that
+ * gnss_init() and the GNSS thread run unchanged against it.
+ * Path of the pts to use as gnss-device-tty is printed on stdout.
+ *
+ * Requests sent by oscillatord are answered from the capture: polls get the
+ * last message of the same class and id recorded, configuration messages are
+ * acknowledged.
+ *
+ * usage: ubx_replay [-s SPEED] [-l] CAPTURE_FILE
+ * - SPEED: pace multiplier, 0 to replay as fast as possible (default: 1)
+ * - -l: loop over the capture
+ */
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <endian.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <error.h>
+#include <fcntl.h>
+#include <sys/select.h>
+
+#include "../src/gnss_capture.h"
+#include "log.h"
+#include "ptspair.h"
+
+#define UBX_SYNC_1       0xb5
+#define UBX_SYNC_2       0x62
+#define UBX_HEADER_SIZE  6
+#define UBX_FRAME_SIZE   8
+#define UBX_ACK_CLSID    0x05
+#define UBX_ACK_ACK_ID   0x01
+#define UBX_CFG_CLSID    0x06
+#define UBX_CFG_VALGET   0x8b
+
+#define OUTPUT_BUFFER_SIZE 0x10000
+#define INPUT_BUFFER_SIZE  0x1000
+
+struct record {
+    uint64_t timestamp;
+    uint32_t length;
+    const uint8_t* data;
+};
+
+struct capture {
+    uint8_t*       content;
+    struct record* records;
+    size_t         count;
+    /* last record of each UBX (class << 8 | id), -1 if none */
+    int32_t        last_ubx[0x10000];
+};
+
+struct output {
+    uint8_t buf[OUTPUT_BUFFER_SIZE];
+    size_t  len;
+};
+
+static volatile bool loop = true;
+
+static void signal_handler(int signum) {
+    log_info("Caught signal %s.", strsignal(signum));
+    loop = false;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool is_ubx(const uint8_t* data, uint32_t length) {
+    return length >= UBX_FRAME_SIZE && data[0] == UBX_SYNC_1 && data[1] == UBX_SYNC_2;
+}
+
+static int load_capture(const char* path, struct capture* capture) {
+    struct gnss_capture_header header;
+    size_t                     size;
+    size_t                     pos;
+    FILE*                      f;
+    long                       file_size;
+
+    f = fopen(path, "rbe");
+    if (f == NULL)
+        return -errno;
+    if (fseek(f, 0, SEEK_END) < 0 || (file_size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) < 0) {
+        fclose(f);
+        return -EIO;
+    }
+    size             = file_size;
+    capture->content = malloc(size);
+    if (capture->content == NULL) {
+        fclose(f);
+        return -ENOMEM;
+    }
+    if (fread(capture->content, 1, size, f) != size) {
+        fclose(f);
+        return -EIO;
+    }
+    fclose(f);
+
+    if (size < sizeof(header))
+        return -EPROTO;
+    memcpy(&header, capture->content, sizeof(header));
+    if (memcmp(header.magic, GNSS_CAPTURE_MAGIC, sizeof(header.magic)) != 0 ||
+        le32toh(header.version) != GNSS_CAPTURE_VERSION)
+        return -EPROTO;
+
+    memset(capture->last_ubx, 0xff, sizeof(capture->last_ubx));
+    pos = sizeof(header);
+    while (pos + sizeof(struct gnss_capture_record) <= size) {
+        struct gnss_capture_record rec;
+        struct record*             records;
+
+        memcpy(&rec, capture->content + pos, sizeof(rec));
+        pos += sizeof(rec);
+        rec.length = le32toh(rec.length);
+        if (rec.length > GNSS_CAPTURE_MAX_RECORD_SIZE || pos + rec.length > size) {
+            log_warn("Truncated record at offset %zu, ignoring end of capture", pos);
+            break;
+        }
+
+        records = realloc(capture->records, (capture->count + 1) * sizeof(*records));
+        if (records == NULL)
+            return -ENOMEM;
+        capture->records = records;
+        records[capture->count].timestamp = le64toh(rec.timestamp);
+        records[capture->count].length    = rec.length;
+        records[capture->count].data      = capture->content + pos;
+        if (is_ubx(capture->content + pos, rec.length))
+            capture->last_ubx[(capture->content[pos + 2] << 8) | capture->content[pos + 3]] = capture->count;
+        capture->count++;
+        pos += rec.length;
+    }
+
+    return capture->count > 0 ? 0 : -ENODATA;
+}
+
+static void output_push(struct output* output, const uint8_t* data, size_t len) {
+    if (output->len + len > sizeof(output->buf)) {
+        log_warn("Output buffer full, dropping %zu bytes", len);
+        return;
+    }
+    memcpy(output->buf + output->len, data, len);
+    output->len += len;
+}
+
+static int output_flush(struct output* output, int fd) {
+    ssize_t sret;
+
+    if (output->len == 0)
+        return 0;
+    sret = write(fd, output->buf, output->len);
+    if (sret < 0)
+        return errno == EAGAIN ? 0 : -errno;
+    memmove(output->buf, output->buf + sret, output->len - sret);
+    output->len -= sret;
+    return 0;
+}
+
+static void ubx_checksum(const uint8_t* data, size_t len, uint8_t* ck_a, uint8_t* ck_b) {
+    *ck_a = 0;
+    *ck_b = 0;
+    for (size_t i = 0; i < len; i++) {
+        *ck_a += data[i];
+        *ck_b += *ck_a;
+    }
+}
+
+static void send_ack(struct output* output, uint8_t cls_id, uint8_t msg_id) {
+    uint8_t ack[UBX_FRAME_SIZE + 2] = {
+        UBX_SYNC_1, UBX_SYNC_2, UBX_ACK_CLSID, UBX_ACK_ACK_ID, 2, 0, cls_id, msg_id
+    };
+
+    ubx_checksum(ack + 2, UBX_HEADER_SIZE - 2 + 2, &ack[8], &ack[9]);
+    output_push(output, ack, sizeof(ack));
+}
+
+/* answer a UBX frame sent by oscillatord */
+static void handle_request(const struct capture* capture, struct output* output, const uint8_t* frame,
+                           size_t len) {
+    uint8_t cls_id = frame[2];
+    uint8_t msg_id = frame[3];
+    int32_t index  = capture->last_ubx[(cls_id << 8) | msg_id];
+
+    log_debug("Request 0x%02x 0x%02x, %zu bytes", cls_id, msg_id, len);
+    /* Poll, or configuration poll whose answer has been recorded */
+    if (index >= 0 && (cls_id != UBX_CFG_CLSID || msg_id == UBX_CFG_VALGET))
+        output_push(output, capture->records[index].data, capture->records[index].length);
+    if (cls_id == UBX_CFG_CLSID)
+        send_ack(output, cls_id, msg_id);
+}
+
+/* extract UBX frames from data sent by oscillatord, returns bytes consumed */
+static size_t parse_requests(const struct capture* capture, struct output* output, const uint8_t* buf, size_t len) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t payload;
+
+        if (buf[pos] != UBX_SYNC_1 || (pos + 1 < len && buf[pos + 1] != UBX_SYNC_2)) {
+            pos++;
+            continue;
+        }
+        if (pos + UBX_HEADER_SIZE > len)
+            break;
+        payload = buf[pos + 4] | (buf[pos + 5] << 8);
+        if (payload + UBX_FRAME_SIZE > INPUT_BUFFER_SIZE) {
+            pos++;
+            continue;
+        }
+        if (pos + payload + UBX_FRAME_SIZE > len)
+            break;
+        handle_request(capture, output, buf + pos, payload + UBX_FRAME_SIZE);
+        pos += payload + UBX_FRAME_SIZE;
+    }
+    return pos;
+}
+
+int main(int argc, char* argv[]) {
+    struct ptspair __attribute__((cleanup(ptspair_clean))) pts;
+    static struct capture capture;
+    static struct output  output;
+    uint8_t               input[INPUT_BUFFER_SIZE];
+    size_t                input_len = 0;
+    const char*           receiver_pts;
+    double                speed     = 1.0;
+    bool                  loop_over = false;
+    uint64_t              start;
+    size_t                next = 0;
+    int                   receiver_fd;
+    int                   pts_fd;
+    int                   ret;
+    int                   c;
+
+    /* must be done early because of the attribute cleanup */
+    memset(&pts, 0, sizeof(pts));
+
+    while ((c = getopt(argc, argv, "s:lh")) != -1) {
+        switch (c) {
+        case 's':
+            speed = atof(optarg);
+            break;
+        case 'l':
+            loop_over = true;
+            break;
+        case 'h':
+        default:
+            error(EXIT_FAILURE, 0, "usage: %s [-s SPEED] [-l] CAPTURE_FILE", argv[0]);
+        }
+    }
+    if (optind != argc - 1 || speed < 0)
+        error(EXIT_FAILURE, 0, "usage: %s [-s SPEED] [-l] CAPTURE_FILE", argv[0]);
+
+    ret = load_capture(argv[optind], &capture);
+    if (ret < 0)
+        error(EXIT_FAILURE, -ret, "load_capture(%s)", argv[optind]);
+    log_info("%zu records loaded", capture.count);
+
+    ret = ptspair_init(&pts);
+    if (ret < 0)
+        error(EXIT_FAILURE, -ret, "ptspair_init");
+    pts_fd = ptspair_get_fd(&pts);
+    ptspair_raw(&pts, PTSPAIR_FOO);
+    ptspair_raw(&pts, PTSPAIR_BAR);
+    receiver_pts = ptspair_get_path(&pts, PTSPAIR_FOO);
+    /* to be used as gnss-device-tty */
+    printf("%s\n", ptspair_get_path(&pts, PTSPAIR_BAR));
+    fclose(stdout);
+
+    receiver_fd = open(receiver_pts, O_RDWR | O_NONBLOCK | O_NOCTTY);
+    if (receiver_fd == -1)
+        error(EXIT_FAILURE, errno, "open(%s)", receiver_pts);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    start = now_ns();
+    while (loop) {
+        struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+        fd_set         readfds;
+        fd_set         writefds;
+        int            maxfd = pts_fd > receiver_fd ? pts_fd : receiver_fd;
+
+        /* Queue records which are due */
+        while (next < capture.count && output.len < OUTPUT_BUFFER_SIZE / 2) {
+            uint64_t offset = capture.records[next].timestamp - capture.records[0].timestamp;
+            uint64_t due    = speed > 0 ? start + (uint64_t)(offset / speed) : start;
+            uint64_t now    = now_ns();
+
+            if (due > now) {
+                if (due - now < 100000000ULL)
+                    tv.tv_usec = (due - now) / 1000;
+                break;
+            }
+            output_push(&output, capture.records[next].data, capture.records[next].length);
+            next++;
+        }
+        if (next == capture.count) {
+            if (!loop_over && output.len == 0) {
+                log_info("End of capture");
+                break;
+            }
+            if (loop_over) {
+                next  = 0;
+                start = now_ns();
+            }
+        }
+
+        FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
+        FD_SET(pts_fd, &readfds);
+        FD_SET(receiver_fd, &readfds);
+        if (output.len > 0)
+            FD_SET(receiver_fd, &writefds);
+        ret = select(maxfd + 1, &readfds, &writefds, NULL, &tv);
+        if (ret == -1) {
+            if (errno == EINTR)
+                continue;
+            error(EXIT_FAILURE, errno, "select");
+        }
+
+        if (FD_ISSET(pts_fd, &readfds)) {
+            ret = ptspair_process_events(&pts);
+            if (ret < 0 && ret != -EINTR)
+                error(EXIT_FAILURE, -ret, "ptspair_process_events");
+        }
+        if (FD_ISSET(receiver_fd, &readfds)) {
+            ssize_t sret = read(receiver_fd, input + input_len, sizeof(input) - input_len);
+            if (sret > 0) {
+                size_t consumed;
+
+                input_len += sret;
+                consumed = parse_requests(&capture, &output, input, input_len);
+                memmove(input, input + consumed, input_len - consumed);
+                input_len -= consumed;
+                if (input_len == sizeof(input))
+                    input_len = 0;
+            }
+        }
+        if (FD_ISSET(receiver_fd, &writefds)) {
+            ret = output_flush(&output, receiver_fd);
+            if (ret < 0)
+                error(EXIT_FAILURE, -ret, "write");
+        }
+    }
+
+    close(receiver_fd);
+    free(capture.records);
+    free(capture.content);
+
+    return EXIT_SUCCESS;
+}
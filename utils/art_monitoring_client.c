@@ -10,9 +10,11 @@
  */
 #include <arpa/inet.h>
 #include <assert.h>
+#include <endian.h>
 #include <getopt.h>
 #include <json-c/json.h>
 #include <netinet/in.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,20 +24,26 @@
 
 #include "log.h"
 #include "monitoring.h"
+#include "monitoring_binary.h"
 
 static void print_help(void)
 {
-	printf("usage: art_monitoring_client [-h -r REQUEST_TYPE] -a ADDRESS -p PORT\n");
+	printf("usage: art_monitoring_client [-h -b -r REQUEST_TYPE] -a ADDRESS -p PORT\n");
 	printf("- -a ADDRESS: Address socket should bind to\n");
 	printf("- -p PORT: Port socket should bind to\n");
+	printf("- -b: use binary protocol instead of json\n");
 	printf("- -r REQUEST_TYPE: send a request to oscillatord. Accepted values are:\n");
 	printf("\t- calibration: request a calibration of the algorithm\n");
+	printf("\t- calibration_abort: abort a running calibration, disciplining resumes at next calibration request\n");
 	printf("\t- gnss_start: start gnss receiver\n");
 	printf("\t- gnss_stop: stop gnss receiver.\n");
 	printf("\t- read_eeprom: read disciplining data from EEPROM.\n");
 	printf("\t- save_eeprom: save minipod's disciplining data in EEPROM.\n");
 	printf("\t- fake_holdover_start: start fake holdover\n");
 	printf("\t- fake_holdover_stop: stop fake holdover.\n");
+	printf("\t- gnss_messages: get counters of messages received from gnss receiver.\n");
+	printf("\t- gnss_signals: get satellites and signals tracked by gnss receiver.\n");
+	printf("\t- boot_timeline: get start up milestones and time to lock of oscillatord.\n");
 	printf("- -h: prints help\n");
 	return;
 }
@@ -71,15 +79,130 @@ static struct json_object *json_send_and_receive(int sockfd, int request)
 	return json_tokener_parse(resp);
 }
 
+/* Receive exactly len bytes from socket */
+static int recv_all(int sockfd, void *buf, size_t len)
+{
+	size_t received = 0;
+
+	while (received < len) {
+		ssize_t ret = recv(sockfd, (char *) buf + received, len - received, 0);
+		if (ret <= 0) {
+			log_error("Error receiving response: %zd", ret);
+			return -1;
+		}
+		received += ret;
+	}
+	return 0;
+}
+
+/* Send binary request and fill binary response */
+static int binary_send_and_receive(int sockfd, int request, struct monitoring_bin_response *resp)
+{
+	struct monitoring_bin_request req = {
+		.magic = MONITORING_BIN_MAGIC,
+		.version = MONITORING_BIN_VERSION,
+		.reserved = 0,
+		.request = htole16(request),
+	};
+	size_t header_len = offsetof(struct monitoring_bin_response, request);
+	size_t length;
+	char discard[64];
+
+	if (send(sockfd, &req, sizeof(req), 0) != sizeof(req)) {
+		log_error("Error sending request");
+		log_error("FAIL");
+		return -1;
+	}
+
+	memset(resp, 0, sizeof(*resp));
+	if (recv_all(sockfd, resp, header_len) < 0)
+		return -1;
+	if (memcmp(resp->magic, MONITORING_BIN_MAGIC, MONITORING_BIN_MAGIC_LEN) != 0) {
+		log_error("Invalid binary response");
+		return -1;
+	}
+	length = le16toh(resp->length);
+	if (length < header_len) {
+		log_error("Invalid binary response length %zu", length);
+		return -1;
+	}
+
+	/* Fields unknown to this client version are skipped */
+	if (recv_all(sockfd, (char *) resp + header_len,
+		(length < sizeof(*resp) ? length : sizeof(*resp)) - header_len) < 0)
+		return -1;
+	while (length > sizeof(*resp)) {
+		size_t chunk = length - sizeof(*resp);
+		if (chunk > sizeof(discard))
+			chunk = sizeof(discard);
+		if (recv_all(sockfd, discard, chunk) < 0)
+			return -1;
+		length -= chunk;
+	}
+	return 0;
+}
+
+/* Print content of binary response */
+static void print_binary_response(const struct monitoring_bin_response *resp)
+{
+	char model[MONITORING_BIN_MODEL_LEN + 1] = {0};
+
+	log_info("Binary response version %u", resp->version);
+	if (resp->flags & MONITORING_BIN_FLAG_DISCIPLINING) {
+		log_info("Disciplining detected");
+		log_info("\t- Current status: %s",
+			cstring_from_disciplining_state(resp->status));
+		log_info("\t- ready_for_holdover: %s",
+			resp->ready_for_holdover ? "true" : "false");
+		log_info("\t- convergence progress: %0.2f %% (%d/%d)",
+			le16toh(resp->convergence_progress) / 100.0,
+			(int32_t) le32toh(resp->current_phase_convergence_count),
+			(int32_t) le32toh(resp->valid_phase_convergence_threshold));
+	}
+
+	memcpy(model, resp->oscillator_model, MONITORING_BIN_MODEL_LEN);
+	log_info("Oscillator detected");
+	log_info("\t- model: %s", model);
+	log_info("\t- fine_ctrl: %d", (int32_t) le32toh(resp->fine_ctrl));
+	log_info("\t- coarse_ctrl: %d", (int32_t) le32toh(resp->coarse_ctrl));
+	log_info("\t- lock: %s", resp->lock ? "True" : "False");
+	log_info("\t- temperature: %f", (int32_t) le32toh(resp->temperature) / 1000.0);
+
+	log_info("Clock detected");
+	log_info("\t- class: %s", cstring_from_clock_class(resp->clock_class));
+	log_info("\t- offset: %d", (int32_t) le32toh(resp->clock_offset));
+
+	log_info("GNSS detected");
+	log_info("\t- fix: %u", resp->fix);
+	log_info("\t- fixOk: %s", resp->fix_ok ? "True" : "False");
+	log_info("\t- antenna_status: %d", resp->antenna_status);
+	log_info("\t- antenna_power: %d", resp->antenna_power);
+	log_info("\t- satellites_count: %u", resp->satellites_count);
+	if ((int32_t) le32toh(resp->survey_in_position_error) < 0)
+		log_info("\t- survey_in_position_error: unknown");
+	else
+		log_info("\t- survey_in_position_error: %0.2f m",
+			(int32_t) le32toh(resp->survey_in_position_error) / 1000.0);
+	log_info("\t- lsChange: %d", resp->ls_change);
+	log_info("\t- leap_seconds: %d", (int16_t) le16toh(resp->leap_seconds));
+
+	if (resp->flags & MONITORING_BIN_FLAG_ACTION)
+		log_info("Action requested: %u", le16toh(resp->request));
+}
+
 int main(int argc, char *argv[]) {
 	int c;
 	int request = REQUEST_NONE;
 	int socket_port = -1;
 	char *socket_addr = NULL;
+	bool binary = false;
 
-	while ((c = getopt(argc, argv, "a:p:r:h")) != -1)
+	while ((c = getopt(argc, argv, "a:p:r:bh")) != -1)
 	switch (c)
 	{
+		case 'b':
+			binary = true;
+			break;
 		case 'a':
 			socket_addr = optarg;
 			break;
@@ -89,6 +212,8 @@ int main(int argc, char *argv[]) {
 		case 'r':
 		if (strcmp(optarg, "calibration") == 0)
 			request = REQUEST_CALIBRATION;
+		else if (strcmp(optarg, "calibration_abort") == 0)
+			request = REQUEST_CALIBRATION_ABORT;
 		else if (strcmp(optarg, "gnss_start") == 0)
 			request = REQUEST_GNSS_START;
 		else if (strcmp(optarg, "gnss_stop") == 0)
@@ -111,6 +236,12 @@ int main(int argc, char *argv[]) {
 			request = REQUEST_MRO_COARSE_INC;
 		else if (strcmp(optarg, "mro_coarse_dec") == 0)
 			request = REQUEST_MRO_COARSE_DEC;
+		else if (strcmp(optarg, "gnss_messages") == 0)
+			request = REQUEST_GNSS_MESSAGES;
+		else if (strcmp(optarg, "gnss_signals") == 0)
+			request = REQUEST_GNSS_SIGNALS;
+		else if (strcmp(optarg, "boot_timeline") == 0)
+			request = REQUEST_BOOT_TIMELINE;
 		else {
 			log_error("Unknown request %s", optarg);
 			return -1;
@@ -162,6 +293,23 @@ int main(int argc, char *argv[]) {
 		return -1;
 	}
 
+	if (binary) {
+		struct monitoring_bin_response resp;
+
+		ret = binary_send_and_receive(sockfd, request, &resp);
+		close(sockfd);
+		if (ret < 0)
+			return -1;
+		if (resp.flags & MONITORING_BIN_FLAG_BAD_VERSION) {
+			log_error("Binary request version %u is not supported by oscillatord",
+				MONITORING_BIN_VERSION);
+			return -1;
+		}
+		print_binary_response(&resp);
+		log_info("PASSED !");
+		return 0;
+	}
+
 	/* Request data through socket */
 	struct json_object *obj = json_send_and_receive(sockfd, request);
 	struct json_object *layer_1;